@@ -0,0 +1,166 @@
+/*! \file usage-static-bench.cpp
+    \brief Measures the startup latency, the cost of the value checks and the throughput of the batch modes of the parse and validate core.
+
+    Run without arguments, it prints one line per measure. The startup latency is measured on POSIX systems, by running this program again
+    as a child process that only parses its command line: the time goes from the exec of the child to its exit.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef __unix__
+#include <spawn.h>
+#include <sys/wait.h>
+#endif
+
+#include <usage-static.hpp>
+
+namespace
+{
+    constexpr size_t BATCH_LINES{ 100000 };
+    constexpr size_t STARTUP_RUNS{ 200 };
+    constexpr size_t UTF8_BYTES{ 8 << 20 };
+
+    // usage of a job runner, with a validator on each named argument if validated is true
+    void build_usage(Usage::Usage& us, bool validated)
+    {
+        Usage::Unnamed_Arg file{ "file" };
+        file.many = true;
+        file.set_required(true);
+        us.add_Argument(file);
+        Usage::Named_Arg mode{ "mode" };
+        mode.set_type(Usage::Argument_Type::string);
+        mode.shortcut_char = 'm';
+        Usage::Named_Arg level{ "level" };
+        level.set_type(Usage::Argument_Type::string);
+        level.shortcut_char = 'l';
+        Usage::Named_Arg date{ "date" };
+        date.set_type(Usage::Argument_Type::string);
+        date.shortcut_char = 'd';
+        if (validated)
+        {
+            mode.set_choices({ "fast", "safe", "full" });
+            level.set_range(0, 9);
+            date.set_pattern("[0-9]{4}-[0-9]{2}-[0-9]{2}");
+        }
+        us.add_Argument(mode);
+        us.add_Argument(level);
+        us.add_Argument(date);
+        Usage::Named_Arg data{ "data" };
+        data.set_type(Usage::Argument_Type::string);
+        us.add_Argument(data);
+        Usage::Named_Arg verbose{ "verbose" };
+        verbose.set_type(Usage::Argument_Type::boolean);
+        verbose.shortcut_char = 'v';
+        us.add_Argument(verbose);
+    }
+
+    std::vector<std::vector<std::string>> batch_lines()
+    {
+        std::string sw{ Usage::Usage{ "" }.switch_char };
+        std::vector<std::vector<std::string>> lines(BATCH_LINES);
+        for (size_t i = 0; i < lines.size(); i++)
+            lines[i] = { "input" + std::to_string(i) + ".txt", sw + "m:safe", sw + "l:" + std::to_string(i % 10), sw + "d:2024-01-31", sw + "v+" };
+        return lines;
+    }
+
+    template<typename F>
+    double seconds(F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // nanoseconds per value spent by the validators, from the difference between a batch with validators and the same batch without them
+    void bench_validators(const std::vector<std::vector<std::string>>& lines)
+    {
+        double times[2]{};
+        for (int validated = 0; validated < 2; validated++)
+        {
+            Usage::Usage us{ "bench" };
+            build_usage(us, validated == 1);
+            us.parse_batch({ lines[0] }, Usage::Batch_Mode::sequential);        // the validators are compiled before the measure
+            times[validated] = seconds([&]() { us.parse_batch(lines, Usage::Batch_Mode::sequential); });
+        }
+        std::printf("validators: %.1f ns per validated value (3 values per line)\n", (times[1] - times[0]) * 1e9 / (lines.size() * 3));
+    }
+
+    void bench_batch_modes(const std::vector<std::vector<std::string>>& lines)
+    {
+        static const char* NAMES[]{ "sequential", "parallel", "pipeline" };
+        Usage::Usage us{ "bench" };
+        build_usage(us, true);
+        for (auto mode : { Usage::Batch_Mode::sequential, Usage::Batch_Mode::parallel, Usage::Batch_Mode::pipeline })
+        {
+            auto time = seconds([&]() { us.parse_batch(lines, mode); });
+            std::printf("batch %s: %.0f lines per second\n", NAMES[static_cast<int>(mode)], lines.size() / time);
+        }
+    }
+
+    // throughput of the UTF-8 check on a large value of multibyte text, from the difference between a parsing with the check and one without it
+    void bench_utf8()
+    {
+        std::string sw{ Usage::Usage{ "" }.switch_char };
+        std::string value{};
+        while (value.size() < UTF8_BYTES)
+            value += "ascii text, \xC3\xA9t\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 ";
+        std::vector<std::vector<std::string>> line{ { "input.txt", sw + "data:" + value } };
+        double times[2]{};
+        for (int checked = 0; checked < 2; checked++)
+        {
+            Usage::Usage us{ "bench" };
+            build_usage(us, false);
+            us.get_Argument("data")->check_utf8 = checked == 1;
+            times[checked] = seconds([&]() { us.parse_batch(line, Usage::Batch_Mode::sequential); });
+        }
+        std::printf("utf-8 check: %.0f MB per second\n", value.size() / (times[1] - times[0]) / 1e6);
+    }
+
+#ifdef __unix__
+    // mean time from the exec of a child process to its exit, the child parsing its command line with the core only
+    void bench_startup(const char* self)
+    {
+        std::string sw{ Usage::Usage{ "" }.switch_char };
+        std::vector<std::string> args{ self, "--child", "input.txt", sw + "m:safe", sw + "l:5", sw + "d:2024-01-31", sw + "v+" };
+        std::vector<char*> argv{};
+        for (auto& arg : args)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+        size_t failed{ 0 };
+        auto time = seconds([&]()
+            {
+                for (size_t i = 0; i < STARTUP_RUNS; i++)
+                {
+                    pid_t pid{};
+                    int status{ 0 };
+                    if (posix_spawn(&pid, self, nullptr, nullptr, argv.data(), nullptr) != 0 || waitpid(pid, &status, 0) != pid
+                        || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                        failed++;
+                }
+            });
+        std::printf("startup: %.1f us from exec to a completed set_parameters() and exit (%zu failed)\n", time * 1e6 / STARTUP_RUNS, failed);
+    }
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+    // child of the startup measure: the command line follows --child, which stands for the program name
+    if (argc > 1 && std::string{ argv[1] } == "--child")
+    {
+        Usage::Usage us{ "--child" };
+        build_usage(us, true);
+        return us.set_parameters(argc - 1, argv + 1) == "" ? 0 : 1;
+    }
+#ifdef __unix__
+    bench_startup(argv[0]);
+#endif
+    auto lines = batch_lines();
+    bench_validators(lines);
+    bench_batch_modes(lines);
+    bench_utf8();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+/*! \file usage-static-coro.hpp
+*	\brief Implements the coroutine parsing of a command line read from an asynchronous source. Requires C++20.
+*/
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <usage-static.hpp>
+
+namespace Usage
+{
+
+    /*! \brief The class Task is a coroutine that returns a value of type T.
+
+        The coroutine is started when it is awaited, or by start() when it is driven by non coroutine code.
+        The awaiting coroutine is resumed when the task ends.
+    */
+    template<typename T>
+    class Task
+    {
+    public:
+        struct promise_type
+        {
+            std::optional<T> value{};
+            std::exception_ptr exception{};
+            std::coroutine_handle<> continuation{};
+
+            Task get_return_object() noexcept { return Task{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct Final_Awaiter
+            {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    auto continuation = handle.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            Final_Awaiter final_suspend() noexcept { return {}; }
+
+            template<typename U>
+            void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+            void unhandled_exception() noexcept { exception = std::current_exception(); }
+        };
+
+        Task(Task&& task) noexcept : m_handle{ std::exchange(task.m_handle, {}) } {}
+        Task& operator=(Task&& task) noexcept
+        {
+            if (this != &task)
+            {
+                if (m_handle)
+                    m_handle.destroy();
+                m_handle = std::exchange(task.m_handle, {});
+            }
+            return *this;
+        }
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        ~Task()
+        {
+            if (m_handle)
+                m_handle.destroy();
+        }
+
+        /*! \brief Starts the coroutine when it is not awaited ; it runs until its first suspension. */
+        void start() { m_handle.resume(); }
+
+        /*! \brief Returns true if the coroutine has ended. */
+        bool done() const noexcept { return m_handle.done(); }
+
+        /*! \brief Gets the result of the coroutine.
+        *   \warning The coroutine must have ended ; the exception it has thrown, if any, is thrown again.
+        */
+        T& result()
+        {
+            if (m_handle.promise().exception)
+                std::rethrow_exception(m_handle.promise().exception);
+            return *m_handle.promise().value;
+        }
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            m_handle.promise().continuation = awaiting;
+            return m_handle;
+        }
+        T await_resume() { return std::move(result()); }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> handle) noexcept : m_handle{ handle } {}
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    /*! \brief Parses a command line whose arguments are awaited from an asynchronous source.
+    *   \param usage the usage that defines the expected arguments
+    *   \param source the source of the arguments ; co_await source.next() must return a std::optional<std::string>, empty at the end of the command line
+    *   \return the state of the parsing, to be passed to Usage::restore() ; its message is the one set_parameters() would return
+    *
+    *   The arguments are read until the end of the command line, even if the parsing is stopped, so that the source is left at the next command line.
+    *   The usage must not be modified while a parsing is in progress.
+    */
+    template<typename Source>
+    Task<Parse_State> parse_async(Usage& usage, Source& source)
+    {
+        Parser parser{ usage };
+        while (auto arg = co_await source.next())
+            parser.push(*arg);
+        parser.finish();
+        co_return parser.state();
+    }
+
+}
@@ -2,13 +2,23 @@
 
 /*! \file usage-static.hpp
 *	\brief Implements the classes Argument_Type, Argument, Named_Arg, Unnamed_Arg and Usage.
+*
+*   The output operators are implemented in the usage-static library ; the usage-static-core library does not depend on iostreams.
 *   \author Christophe COUAILLET
 */
 
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <iosfwd>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <requirements.hpp>
@@ -16,6 +26,13 @@
 
 namespace Usage
 {
+    class Usage;
+    class Default_Values;
+
+    /*! \brief Function computing the default value of a named argument from the values of the other arguments.
+        \sa Named_Arg::set_default_value()
+    */
+    using Default_Function = std::function<std::string(const Default_Values& values)>;
 
     /*! \brief Defines the types of Named_Arg (named argument) objects:
     *   \li string: passed as Argument:value,
@@ -28,6 +45,26 @@ namespace Usage
         simple = 2          // passed as Argument without additional value
     };
 
+    /*! \brief Defines the checks applied to values that are paths of the filesystem. Checks can be combined with operator |.
+    *   \li exists: the path must exist,
+    *   \li is_file: the path must be a regular file,
+    *   \li is_dir: the path must be a directory,
+    *   \li readable: the path must be readable by the process.
+    */
+    enum class Path_Check {
+        none = 0,
+        exists = 1,
+        is_file = 2,
+        is_dir = 4,
+        readable = 8
+    };
+
+    /*! \brief Combines path checks. */
+    inline Path_Check operator|(Path_Check a, Path_Check b) noexcept { return (Path_Check)((int)a | (int)b); }
+
+    /*! \brief Intersects path checks. */
+    inline Path_Check operator&(Path_Check a, Path_Check b) noexcept { return (Path_Check)((int)a & (int)b); }
+
     /*! \brief An abstract class that defines the bases of classes Named_Arg (named argument) and Unnamed_Arg (unnamed argument). */
     class Argument
     {
@@ -40,7 +77,7 @@ namespace Usage
         /*! \brief Gets the name of the argument (set at instantiation).
         *   \return the name of the argument
         */
-        std::string name() const noexcept;
+        const std::string& name() const noexcept;
 
         /*! \brief Sets or gets the help string (displayed in the usage output).
         *   \return the help string associated with the argument
@@ -56,6 +93,18 @@ namespace Usage
         /*! \brief List of values passed for the argument. Unnamed arguments can contain several values. */
         std::vector<std::string> value{};
 
+        /*! \brief Sets or gets the checks applied to the values when they are paths of the filesystem, none by default.
+
+            Paths are checked all at once after the rules, and all the invalid paths are reported in the message.
+        */
+        Path_Check path_check{ Path_Check::none };
+
+        /*! \brief Sets or gets the check that the values are valid UTF-8 text, false by default.
+
+            On x86 CPUs, the values of 64 bytes or more are checked 32 or 16 bytes at a time with AVX2 or SSSE3, selected when first used.
+        */
+        bool check_utf8{ false };
+
         Argument() = delete;
         /*! \brief Default constructor that sets the name of the argument.
         *   \param name the name to give to the named argument
@@ -96,8 +145,15 @@ namespace Usage
         *   \param os the output stream
             \param indent optional string inserted before the argument help
             \return the modified output stream
+            \note Not virtual so that the output stays out of the core library ; it dispatches on named() to print the fields of the named or unnamed argument.
         */
-        virtual std::ostream& print(std::ostream& os, const std::string& indent = "") const;
+        std::ostream& print(std::ostream& os, const std::string& indent = "") const;
+
+    private:
+        // print the fields common to all the arguments, and the whole definition of each kind of argument
+        std::ostream& m_print_fields(std::ostream& os, const std::string& indent) const;
+        std::ostream& m_print_named(std::ostream& os, const std::string& indent) const;
+        std::ostream& m_print_unnamed(std::ostream& os, const std::string& indent) const;
     };
 
     /*! \brief Class for named arguments.
@@ -126,13 +182,18 @@ namespace Usage
         *   \return the type of the argument
         *   \sa Argument_Type
         */
-        Argument_Type type() noexcept { return m_type; }
+        Argument_Type type() const noexcept { return m_type; }
 
         /*! \brief Gets the default value applied when the argument is not used.
         *   \return a string containing the default value of the argument
         */
         std::string default_value() noexcept { return m_default_value; }
 
+        /*! \brief Gets the function that computes the default value.
+        *   \return the function, empty if the default value is constant
+        */
+        const Default_Function& default_function() const noexcept { return m_default_function; }
+
         Named_Arg() = delete;
 
         /*! \brief Default constructor that sets the name of the argument.
@@ -167,6 +228,72 @@ namespace Usage
         */
         void set_default_value(const std::string& default_value);
 
+        /*! \brief Sets a default value computed from the values of the other arguments.
+        *   \param function the function returning the default value ; it reads the values of the other arguments through Default_Values::get_values()
+        *
+        *   The default value is applied under the same conditions as a constant one. It is computed once per parsing, when all the rules are met,
+        *   and stored in the parse state as the other values. The function may read other computed default values, which are then computed first.
+        *   If the function reads its own value, directly or through other computed default values, the parsing fails with Parse_Error::default_cycle.
+        *   The function may be called by several threads at once during Usage::parse_batch().
+        *   \warning An assertion occurs if the argument is required or of type simple.
+        */
+        void set_default_value(Default_Function function);
+
+        /*! \brief Sets a default value that depends on the value of another argument.
+        *   \param argument the name of the argument the default value depends on
+        *   \param defaults the default value for each value of the other argument
+        *   \param otherwise the default value if the other argument has no value or another value
+        *   \sa Named_Arg::set_default_value(Default_Function)
+        */
+        void set_default_value(const std::string& argument, const std::unordered_map<std::string, std::string>& defaults, const std::string& otherwise);
+
+        /*! \brief Gets the values accepted for the argument.
+        *   \return the list of accepted values, empty if any value is accepted
+        */
+        std::vector<std::string> choices() const { return m_choices; }
+
+        /*! \brief Sets the values accepted for the argument.
+        *   \param choices the list of accepted values, an empty list accepts any value
+        *   \warning An assertion occurs if the argument is not of type string.
+        */
+        void set_choices(const std::vector<std::string>& choices);
+
+        /*! \brief Checks if the value of the argument must be a number in a range.
+        *   \return true if a range has been set
+        *   \sa Named_Arg::set_range()
+        */
+        bool ranged() const noexcept { return m_ranged; }
+
+        /*! \brief Gets the lower bound of the range of values. */
+        double range_min() const noexcept { return m_min; }
+
+        /*! \brief Gets the upper bound of the range of values. */
+        double range_max() const noexcept { return m_max; }
+
+        /*! \brief Sets the range of numeric values accepted for the argument.
+        *   \param min,max the bounds of the range, included
+        *
+        *   The values are read as decimal numbers, with an optional sign and exponent, whatever the locale. Spaces, hexadecimal numbers,
+        *   infinite and nan values are invalid.
+        *   \warning An assertion occurs if the argument is not of type string or if min is greater than max.
+        */
+        void set_range(double min, double max);
+
+        /*! \brief Removes the range of values. */
+        void clear_range() noexcept { m_ranged = false; }
+
+        /*! \brief Gets the regular expression that values must match.
+        *   \return the regular expression, empty if any value is accepted
+        */
+        std::string pattern() const { return m_pattern; }
+
+        /*! \brief Sets the regular expression (ECMAScript grammar) that values must match entirely.
+        *   \param pattern the regular expression, empty to accept any value
+        *   \warning An assertion occurs if the argument is not of type string.
+        *   \note The expression is compiled once per Usage instance before the first parsing; std::regex_error is thrown then if the expression is invalid, or the program is terminated in builds without exceptions.
+        */
+        void set_pattern(const std::string& pattern);
+
     protected:
         /*! \brief Sets or gets the type of the argument. The argument type is simple by default.*/
         Argument_Type m_type{ Argument_Type::simple };
@@ -174,13 +301,26 @@ namespace Usage
         /*! \brief Sets or gets the default value of the argument. */
         std::string m_default_value{};
 
-        /*! \brief Prints in the output stream the help string of the argument.
-        *   \param os the output stream
-            \param indent optional string inserted before the argument help
-            \return the modified output stream
-            \sa Argument::print()
-        */
-        virtual std::ostream& print(std::ostream& os, const std::string& indent = "") const override;
+        /*! \brief Sets or gets the function that computes the default value of the argument. */
+        Default_Function m_default_function{};
+
+        /*! \brief Sets or gets the accepted values. */
+        std::vector<std::string> m_choices{};
+
+        /*! \brief Sets or gets if the value must be a number in the range [m_min, m_max]. */
+        bool m_ranged{ false };
+
+        /*! \brief Sets or gets the lower bound of the range. */
+        double m_min{ 0 };
+
+        /*! \brief Sets or gets the upper bound of the range. */
+        double m_max{ 0 };
+
+        /*! \brief Sets or gets the regular expression that values must match. */
+        std::string m_pattern{};
+
+        friend class Argument;
+        friend std::ostream& operator<<(std::ostream& os, const Argument& argument);
     };
 
     /*! \brief Class for unnamed arguments.
@@ -205,6 +345,13 @@ namespace Usage
         /*! \brief Sets or gets the capability of the argument to accept many values. */
         bool many{ false };
 
+        /*! \brief Sets or gets the expansion of wildcards (*, ?, [...] and ** for any subdirectory) in the values, false by default.
+
+            Only applies to arguments that accept many values. Matching paths are added in sorted order; a value without match is kept as is.
+            A trailing ** matches all the files and directories below, as with the globstar option of the shells.
+        */
+        bool glob{ false };
+
         Unnamed_Arg() = delete;
 
         /*! \brief Default constructor that sets the name of the argument.
@@ -215,27 +362,216 @@ namespace Usage
         /*! \brief Copy constructor by reference.
         *   \param argument the argument to copy
         */
-        Unnamed_Arg(const Unnamed_Arg& argument) : Argument(argument) { many = argument.many; }
+        Unnamed_Arg(const Unnamed_Arg& argument) : Argument(argument) { many = argument.many; glob = argument.glob; }
 
         /*! \brief Copy constructor by pointer.
         *   \param argument the argument to copy
         */
-        Unnamed_Arg(const Unnamed_Arg* argument) : Argument(argument) { many = argument->many; }
+        Unnamed_Arg(const Unnamed_Arg* argument) : Argument(argument) { many = argument->many; glob = argument->glob; }
 
         /*! \brief Sets if the argument is mandatory or not.
         *   \param required true to set the argument as mandatory, else false
         */
         virtual void set_required(const bool required) override { Argument::m_required = required; }
 
-    protected:
+        friend std::ostream& operator<<(std::ostream& os, const Argument& argument);
+    };
 
-        /*! \brief Prints in the output stream the help string of the argument.
-        *   \param os the output stream
-            \param indent optional string inserted before the argument help
-            \return the modified output stream
-            \sa Argument::print()
+    /*! \brief Defines how a batch of command lines is processed:
+    *   \li sequential: the command lines are processed one after the other by the calling thread,
+    *   \li parallel: each thread processes a share of the command lines from start to end,
+    *   \li pipeline: the split, the matching of the arguments and the check of the rules run on three threads, each one processing all the command lines ;
+    *   the command lines are streamed from one stage to the next through bounded queues, so at most a few hundred of them are in progress at a time.
+    */
+    enum class Batch_Mode {
+        sequential = 0,
+        parallel = 1,
+        pipeline = 2
+    };
+
+    /*! \brief Defines the reasons of a parsing fail. */
+    enum class Parse_Error {
+        none = 0,               // parameters are valid
+        help = 1,               // usage help requested
+        no_argument = 2,        // empty command line
+        syntax = 3,             // argument malformed or unexpected
+        unknown_argument = 4,   // named argument unknown or passed twice
+        type_mismatch = 5,      // named argument passed with another type
+        missing_argument = 6,   // required argument not passed
+        conflict = 7,           // arguments in conflict passed together
+        invalid_value = 8,      // value rejected by the choices, range or pattern of the argument
+        invalid_path = 9,       // path rejected by the path checks of the argument
+        invalid_utf8 = 10,      // value that is not valid UTF-8 text
+        limit_exceeded = 11,    // command line beyond the limits set in the usage
+        default_cycle = 12      // computed default value that depends on itself
+    };
+
+    /*! \brief Bounds of the command lines accepted by a usage, 0 meaning no limit.
+
+        They protect the parsing of untrusted command lines: they are checked before the values are copied and the parsing stops on the first limit exceeded.
+    */
+    struct Limits
+    {
+        /*! \brief Maximum number of arguments of the command line, the program name excluded. */
+        size_t max_tokens{ 0 };
+
+        /*! \brief Maximum total size in bytes of the arguments of the command line. */
+        size_t max_bytes{ 0 };
+
+        /*! \brief Maximum size in bytes of one argument of the command line. */
+        size_t max_value_length{ 0 };
+
+        /*! \brief Maximum number of values of an unnamed argument that accepts many values, wildcard expansions included. */
+        size_t max_values{ 0 };
+    };
+
+    /*! \brief Holds the result of the parsing of a command line.
+
+        Values and flags are stored in the order the arguments were added to the Usage instance.
+        The state of the last parsing is kept by the Usage instance to allow the incremental update of parameters.
+        \sa Usage::set_parameters()
+        \sa Usage::set_parameter()
+    */
+    struct Parse_State
+    {
+        /*! \brief Values assigned to each argument ; computed default values are present only if all the rules are met. */
+        std::vector<std::vector<std::string>> values{};
+
+        /*! \brief Flags of the arguments passed through the command line or that received their default value. */
+        std::vector<bool> set_args{};
+
+        /*! \brief Flags of the arguments that received their default value. */
+        std::vector<bool> defaults{};
+
+        /*! \brief True if all the arguments of the command line have been read, even if a rule is broken. */
+        bool parsed{ false };
+
+        /*! \brief The message returned by the parsing, empty if succeeded. */
+        std::string message{};
+
+        /*! \brief The reason of the parsing fail. */
+        Parse_Error error{ Parse_Error::none };
+
+        /*! \brief The argument involved in the parsing fail, as named in the usage or as passed if it is unknown or malformed ; the term searched if help is required. */
+        std::string error_argument{};
+
+        /*! \brief The deprecated aliases used in the command line. */
+        std::vector<std::string> deprecated{};
+
+        /*! \brief Bytes of the arguments read, including the ones passed to Usage::set_parameter(), counted against Limits::max_bytes. */
+        size_t bytes{ 0 };
+    };
+
+    /*! \brief Gives the values of the command line being checked to the functions computing default values.
+        \sa Named_Arg::set_default_value(Default_Function)
+    */
+    class Default_Values
+    {
+    public:
+        /*! \brief Gets the values of an argument in the command line being checked ; its default value is computed first if needed.
+        *   \param name the name of the argument
+        *   \return the values of the argument, empty if it is not set or if its default value depends on itself
+        *   \warning An assertion occurs if the argument name is unknown.
         */
-        virtual std::ostream& print(std::ostream& os, const std::string& indent = "") const override;
+        const std::vector<std::string>& get_values(const std::string& name) const;
+
+        /*! \brief Gets the usage checking the command line. */
+        const Usage& usage() const noexcept { return m_usage; }
+
+    private:
+        Default_Values(const Usage& usage, Parse_State& state);
+
+        // computes the default value of the argument if it has not been done
+        void m_resolve(size_t arg_index) const;
+
+        const Usage& m_usage;
+        Parse_State& m_state;
+        mutable std::vector<char> m_marks{};    // for each argument, 0 if its default value is to be computed, 1 if being computed, 2 if done
+        mutable std::string m_cycle{};          // the first argument found whose default value depends on itself
+
+        friend class Usage;
+    };
+
+    struct Pooled_State;
+
+    /*! \brief Pool of unique values shared by the states of batches, each value being stored once and identified by a number.
+
+        Identical values get the same identifier, so the values of the states can be compared and grouped by identifier.
+        Values can be added by several threads at once, but they must not be read while values are added.
+        \sa Usage::parse_batch()
+    */
+    class Value_Pool
+    {
+    public:
+        /*! \brief Identifier of a value in the pool. */
+        using Id = std::uint32_t;
+
+        /*! \brief Adds a value to the pool if it is not yet in it.
+        *   \param value the value to add
+        *   \return the identifier of the value
+        */
+        Id intern(std::string_view value);
+
+        /*! \brief Gets a value of the pool.
+        *   \param id the identifier returned by intern()
+        *   \return the value
+        *   \warning An assertion occurs if the identifier is unknown.
+        */
+        const std::string& value(Id id) const;
+
+        /*! \brief Gets the number of values in the pool. */
+        size_t size() const noexcept;
+
+        /*! \brief Moves the values of a parse state to the pool.
+        *   \param state the state to store
+        *   \return the state without its values, and the identifiers of its values
+        */
+        Pooled_State add(Parse_State state);
+
+        /*! \brief Gets the parse state with its values, to be passed to Usage::restore().
+        *   \param pooled a state returned by add() or by Usage::parse_batch()
+        *   \return the state with the values read from the pool
+        */
+        Parse_State expand(const Pooled_State& pooled) const;
+
+    private:
+        // the values are spread over shards selected by their hash, so that threads rarely wait for each other
+        // the identifier of a value is its index in its shard multiplied by the number of shards, plus the index of the shard
+        static constexpr size_t SHARDS{ 16 };
+        struct Shard
+        {
+            std::mutex mutex{};
+            std::deque<std::string> values{};      // a deque keeps the values in place when it grows
+            std::unordered_map<std::string_view, Id> ids{};
+        };
+        std::array<Shard, SHARDS> m_shards{};
+    };
+
+    /*! \brief Holds the result of the parsing of a command line, its values being stored in a Value_Pool.
+        \sa Value_Pool::expand()
+    */
+    struct Pooled_State
+    {
+        /*! \brief Identifiers of the values of all the arguments, in the order of the arguments. */
+        std::vector<Value_Pool::Id> values{};
+
+        /*! \brief Index in values of the first value of each argument, followed by the number of values. */
+        std::vector<std::uint32_t> offsets{};
+
+        /*! \brief The state of the parsing, without its values. */
+        Parse_State state{};
+    };
+
+    /*! \brief Holds the result of the check of the command line of a running process.
+        \sa Usage::audit_processes()
+    */
+    struct Process_Audit
+    {
+        /*! \brief Identifier of the process. */
+        int pid{ 0 };
+
+        /*! \brief Result of the parsing of the command line of the process. */
+        Parse_State state{};
     };
 
     /*! \brief The class Usage handles the list of arguments and their rules.
@@ -247,11 +583,19 @@ namespace Usage
     {
     private:
 
-        // table of arguments
-        std::unordered_map<std::string, Argument*> m_arguments{};
+        // memory of the arguments and of the internal tables
+        std::pmr::memory_resource* m_resource;
+
+        // table of arguments, keyed by the names they own
+        std::pmr::unordered_map<std::string_view, Argument*> m_arguments{ m_resource };
 
         // this non sorted container is used to keep the order in which arguments are defined, mainly for unnamed arguments
-        std::vector<Argument*> m_argsorder{};
+        std::pmr::vector<Argument*> m_argsorder{ m_resource };
+
+        // create and destroy the arguments in the memory resource
+        template<typename T>
+        Argument* m_create(const T& argument);
+        void m_destroy(Argument* argument) noexcept;
 
         // arguments that requires use of other arguments
         Requirements::Requirements<const Argument*> m_requirements{ false };
@@ -263,27 +607,211 @@ namespace Usage
         // command line syntax
         std::string m_syntax_string{};
 
-        // build the command line syntax ; build_syntax is called each time the operator << is used
-        //void create_syntax();               // TODO
+        // build the command line syntax from the arguments, the requirements and the conflicts ; the syntax is kept until the arguments or rules change
+        void create_syntax();
         bool m_syntax_valid{ false };
 
-        // process string that does not start with the switch char
-        bool m_check_unnamed(const std::string& value, std::vector<bool>& set_args, bool& many, size_t& unnamed);
-
-        // checks value type
-        std::string m_check_type(const std::string& p, Argument_Type type_p, const std::string& value, std::vector<bool>& set_args);
+        // usage help laid out for m_help_width columns, kept until the arguments, the rules, the texts or the width change
+        std::string m_help{};
+        std::string m_help_texts{};         // description, syntax and usage the help was laid out with
+        size_t m_help_width{ 0 };
+        bool m_help_valid{ false };
+
+        // words of the names and help strings of the arguments, lower case, with the index of the argument in m_argsorder ; sorted to search the words by prefix
+        // built on the first help search and kept until the arguments or the rules change
+        std::pmr::vector<std::pair<std::pmr::string, size_t>> m_help_index{ m_resource };
+        bool m_help_indexed{ false };
+
+        // state of the last parsing, used by incremental updates
+        Parse_State m_state{};
+
+        // alternative names of named arguments
+        struct Alias
+        {
+            std::string alias{};
+            std::string name{};             // name of the target argument
+            std::string value{};            // value assigned to the target argument if rewrite is true
+            bool rewrite{ false };
+            bool deprecated{ false };
+        };
+        std::pmr::vector<Alias> m_aliases{ m_resource };
+
+        // number of uses of each deprecated alias
+        std::pmr::unordered_map<std::pmr::string, size_t> m_deprecated_uses{ m_resource };
+        void m_count_deprecated(std::string_view alias);
+
+        // the keys of the lookup tables are the names owned by the arguments and the aliases ; if m_folded, they are folded to lower case
+        // in one arena when the lookup tables are built, and released with them
+        std::pmr::monotonic_buffer_resource m_name_arena{ m_resource };
+        std::string_view m_intern(std::string_view name);
+
+        // lookup tables built from the arguments before parsing ; alias is NO_ALIAS for names and shortcuts
+        static constexpr std::uint32_t NO_ALIAS{ UINT32_MAX };
+        struct Name_Entry
+        {
+            std::uint32_t index{ 0 };
+            std::uint32_t alias{ NO_ALIAS };
+        };
+        std::pmr::unordered_map<std::string_view, Name_Entry> m_names{ m_resource };
+        std::pmr::unordered_map<const Argument*, size_t> m_indexes{ m_resource };
+        bool m_compiled{ false };
+        bool m_folded{ false };             // value of case_insensitive when the lookup tables were built
+        bool m_help_search{ true };         // false if the help argument is also a name, a shortcut or an alias, which then receives the values
+
+        // compiled regular expression, defined with the parser so that this header does not include <regex>
+        struct Pattern;
+        struct Pattern_Deleter
+        {
+            void operator()(Pattern* pattern) const noexcept;
+        };
+
+        // validators of the values of named arguments, built from the arguments before parsing
+        struct Validator
+        {
+            std::unordered_set<std::string> choices{};
+            bool ranged{ false };
+            double min{ 0 };
+            double max{ 0 };
+            const Pattern* pattern{ nullptr };
+        };
+        std::pmr::vector<Validator> m_validators{ m_resource };
+
+        // compiled regular expressions by expression, kept while the instance lives
+        std::pmr::unordered_map<std::pmr::string, std::unique_ptr<Pattern, Pattern_Deleter>> m_patterns{ m_resource };
+
+        // independent groups of arguments linked by requirements or conflicts, the rules are never broken across groups
+        // the arguments of a component are contiguous in m_members, in their order, from m_component_offsets[c] to m_component_offsets[c + 1]
+        std::pmr::vector<size_t> m_component{ m_resource };
+        std::pmr::vector<size_t> m_component_offsets{ m_resource };
+        std::pmr::vector<size_t> m_members{ m_resource };
+
+        // checks the value against the validator of the argument
+        bool m_valid_value(size_t arg_index, const std::string& value) const;
+
+        // build the lookup tables if arguments changed
+        void m_compile();
+
+        // a command line argument split into its components
+        struct Token
+        {
+            enum class Kind { named, unnamed, help, invalid, limit };
+            Kind kind{ Kind::invalid };
+            std::string name{};
+            Argument_Type type{ Argument_Type::simple };
+            std::string value{};            // the raw argument for invalid tokens, the limit for exceeded limits
+            size_t position{ 0 };           // position in the command line
+            size_t length{ 0 };             // bytes of the argument, counted against limits.max_bytes
+        };
+
+        // called each time the arguments or their rules change
+        void m_invalidate() noexcept;
+
+        // copy the values of the parse state to the arguments
+        void m_publish();
+        void m_publish(size_t arg_index);
+
+        // checks if the argument received a default value computed by a function
+        bool m_computed_default(size_t arg_index, const Parse_State& state) const;
+
+        // computes the default values of the state that are computed by a function ; they are only cleared if compute is false
+        std::string m_resolve_defaults(Parse_State& state, bool compute) const;
+
+        // computes again the computed default values of the last parsing after an incremental change, and publishes them
+        void m_update_defaults();
+
+        // checks if the argument has a constant or computed default value
+        bool m_has_default(size_t arg_index) const;
+
+        // index of the argument in m_argsorder
+        size_t m_index(const Argument* argument) const;
+
+        // entry of the named argument matching the name, the shortcut or an alias, nullptr if not found
+        const Name_Entry* m_find_named(std::string_view name) const;
+
+        // split a command line argument ; only the name and the value are copied
+        Token m_tokenize(std::string_view arg) const;
+
+        // split all the arguments of the command line ; a single limit token is returned if a limit is exceeded
+        std::vector<Token> m_tokenize(int argc, char* argv[]) const;
+
+        // true if the arguments are split the same way as by the other usage: same limits of the command line, same case folding and same help search
+        bool m_same_tokenizer(const Usage& other) const noexcept;
+
+        // add a value to an unnamed argument, expanding wildcards if requested ; false if the limit of values is exceeded
+        // parallel is false when the caller already runs in parallel, the wildcards are then expanded by the calling thread only
+        bool m_add_unnamed(size_t arg_index, const std::string& value, Parse_State& state, bool parallel) const;
+
+        // process string that does not start with the switch char ; the error is set if a limit is exceeded
+        bool m_check_unnamed(const std::string& value, Parse_State& state, bool& many, size_t& unnamed, bool parallel) const;
+
+        // checks value type ; replace allows to change the value of an argument yet set
+        std::string m_check_type(const std::string& p, Argument_Type type_p, const std::string& value, Parse_State& state, size_t& arg_index, Parse_Error& error, bool replace = false) const;
+
+        // a token reporting the limit exceeded
+        static Token m_limit(const char* name, size_t value, size_t position);
+
+        // checks the size of an argument and adds it to bytes ; token receives the limit exceeded if any
+        bool m_check_limits(const char* arg, size_t position, size_t& bytes, Token& token) const;
+        bool m_check_limits(size_t length, size_t position, size_t& bytes, Token& token) const;
+
+        // parse one token of the command line ; many and unnamed keep track of the unnamed argument receiving the values
+        std::string m_parse_token(const Token& token, Parse_State& state, bool& many, size_t& unnamed, bool parallel = true) const;
 
         // parse the command line
-        std::string m_parser(int argc, char* argv[], std::vector<bool>& set_args);
+        std::string m_parser(const std::vector<Token>& tokens, Parse_State& state, bool parallel = true) const;
+
+        // split a command line given without the program name
+        std::vector<Token> m_tokenize(const std::vector<std::string>& args) const;
+
+        // split a command line held in a buffer of null-terminated strings, starting with the program name
+        std::vector<Token> m_tokenize(const char* buffer, size_t size) const;
+
+        // matching and checking stages of a batch
+        void m_batch_parse(const std::vector<Token>& tokens, Parse_State& state, bool parallel) const;
+        void m_batch_check(Parse_State& state, bool parallel) const;
+
+        // parse count command lines in the given mode, tokenize(i) returns the tokens of the command line i and store(i, state) receives its state
+        template<typename F, typename G>
+        void m_batch(size_t count, F tokenize, G store, Batch_Mode mode);
+
+        // parse the command line and check the rules, the result is kept in m_state
+        std::string m_set_parameters(const std::vector<Token>& tokens);
+
+        // checks if the default value of the argument must be applied
+        bool m_default_applies(size_t arg_index, const Parse_State& state) const;
 
         // process requirements
-        void m_check_requirements(size_t arg_index, std::vector<bool>& set_args);
+        void m_check_requirements(size_t arg_index, Parse_State& state) const;
+
+        // checks if a required argument is missing
+        bool m_missing(size_t arg_index, const Parse_State& state) const;
 
         // process single argument
-        size_t m_check_argument(std::vector<bool>& set_args);
+        size_t m_check_argument(Parse_State& state) const;
+
+        // rule broken between 2 arguments, Parse_Error::none if none
+        Parse_Error m_pair_error(size_t i, size_t j, const Parse_State& state) const;
+
+        // checks the rules between 2 arguments
+        std::string m_check_pair(size_t i, size_t j, Parse_State& state) const;
 
-        // check dependencies
-        std::string m_check_dependencies(std::vector<bool>& set_args);
+        // first pair of arguments of the component that breaks a rule, the size of the arguments if none
+        std::pair<size_t, size_t> m_first_broken(size_t component, const Parse_State& state) const;
+
+        // check dependencies ; parallel allows to check the components of large usages on several threads
+        std::string m_check_dependencies(Parse_State& state, bool parallel = true) const;
+
+        // check values against the validators, for all the arguments or the affected ones
+        std::string m_check_values(Parse_State& state, const std::vector<size_t>* affected = nullptr) const;
+
+        // check paths, for all the arguments or the affected ones ; by the calling thread only if parallel is false
+        std::string m_check_paths(Parse_State& state, const std::vector<size_t>* affected = nullptr, bool parallel = true) const;
+
+        // check values, dependencies and paths of parsed arguments
+        std::string m_check_all(Parse_State& state, bool parallel = true) const;
+
+        // check only the rules affected by a change of the given argument
+        std::string m_revalidate(size_t arg_index);
 
     public:
 
@@ -303,6 +831,16 @@ namespace Usage
         const std::string help_arg{ "h" };
 #endif
 
+        /*! \brief Sets or gets the limits applied to the command lines. */
+        Limits limits{};
+
+        /*! \brief Sets or gets if the names, shortcuts and aliases of the named arguments are matched ignoring the case of ASCII letters.
+
+            The names are folded once when the lookup tables are built, which is done again before the next parsing if this setting changes.
+            Values are never folded. In this mode, names and shortcuts must be unique ignoring case, else an assertion occurs before parsing.
+        */
+        bool case_insensitive{ false };
+
         /*! \brief Sets or gets the name of the program.*/
         std::string program_name{};
         /*! \brief Sets or gets the brief description of the program that is displayed before the syntax and arguments explanation. */
@@ -315,9 +853,11 @@ namespace Usage
 
         /*! \brief Default constructor that sets the program name.
         *   \param prog_name the name of the executable that uses this class to manage its arguments
+        *   \param resource the memory resource of the arguments and of the internal tables, the default resource if not set
             \note The absolute path of the executable is present in the first argument argv[0] passed to the main function.
+            \note The resource must outlive the instance. Requirements, conflicts and the strings held by the arguments use the default allocator.
         */
-        Usage(const std::string& prog_name);    // program name is in argv[0] passed to main()
+        Usage(const std::string& prog_name, std::pmr::memory_resource* resource = std::pmr::get_default_resource());    // program name is in argv[0] passed to main()
 
         /*! \brief Destructor. */
         ~Usage();
@@ -343,14 +883,29 @@ namespace Usage
         /*! \brief Search an argument by its name.
         *   \param name the name of the argument to search for
         *   \return a pointer to the argument if found else nullptr
+        *
+        *   As the argument may be modified through the pointer, the lookup tables and the help are built again before their next use.
         */
         Argument* get_Argument(const std::string& name);
 
+        /*! \brief Search an argument by its name, for reading only.
+        *   \param name the name of the argument to search for
+        *   \return a pointer to the argument if found else nullptr ; the lookup tables and the help are kept
+        */
+        const Argument* get_Argument(const std::string& name) const;
+
         /*! \brief Lists arguments.
         *   \return the list of pointers to arguments
+        *
+        *   As the arguments may be modified through the pointers, the lookup tables and the help are built again before their next use.
         */
         std::vector<Argument*> get_Arguments();
 
+        /*! \brief Lists arguments, for reading only.
+        *   \return the list of pointers to arguments ; the lookup tables and the help are kept
+        */
+        std::vector<const Argument*> get_Arguments() const;
+
         /*! \brief Lists all arguments with their assigned values.
         *   \return the list of argument names with their assigned value(s)
         */
@@ -513,11 +1068,55 @@ namespace Usage
         */
         void set_conflicts(const std::unordered_multimap<std::string, std::string>& conflicts);
 
-        /*! \brief Loads the usage data from the given file.
+        /*! \brief Adds an alternative name to a named argument.
+        *   \param alias the alternative name, usable through the command line as the name of the argument
+        *   \param name the name of the argument
+        *   \param deprecated true to count the uses of the alias
+        *   \warning An assertion occurs if the argument name is unknown or not a named argument, or if the alias is yet used as an argument name or alias.
+        *   \sa Usage::get_deprecated_uses()
+        */
+        void add_alias(const std::string& alias, const std::string& name, bool deprecated = false);
+
+        /*! \brief Adds a simple argument that is rewritten as a named argument with the given value (i.e. /fast becomes /mode:fast).
+        *   \param alias the name of the simple argument to rewrite
+        *   \param name the name of the string or boolean argument that receives the value
+        *   \param value the value assigned to the argument, true or false for a boolean argument
+        *   \param deprecated true to count the uses of the alias
+        *   \warning An assertion occurs if the argument name is unknown or of type simple, or if the alias is yet used as an argument name or alias.
+        *   \sa Usage::add_alias()
+        */
+        void add_rewrite(const std::string& alias, const std::string& name, const std::string& value, bool deprecated = false);
+
+        /*! \brief Removes an alias or a rewrite.
+        *   \param alias the alias to remove
+        *   \warning An assertion occurs if the alias is unknown.
+        */
+        void remove_alias(const std::string& alias);
+
+        /*! \brief Lists the aliases of the given argument.
+        *   \param name the name of the argument
+        *   \return the list of aliases and rewrites of the argument
+        *   \warning An assertion occurs if the argument name is unknown.
+        */
+        std::vector<std::string> get_aliases(const std::string& name) const;
+
+        /*! \brief Gets the number of uses of each deprecated alias since the instantiation or the last call to clear_deprecated_uses().
+        *   \return the pairs alias, number of uses
+        */
+        std::unordered_map<std::string, size_t> get_deprecated_uses() const;
+
+        /*! \brief Resets the number of uses of deprecated aliases. */
+        void clear_deprecated_uses() noexcept { m_deprecated_uses.clear(); }
+
+        /*! \brief Replaces the arguments and their rules by the ones described in the given file.
         *   \param fname the name of the file containing the data
-            \todo Not yet implemented.
+        *   \return an empty string if succeeded, else the reason of the fail ; the usage is not modified in this case
+        *
+        *   The first line of the file is the syntax of the command line, as accepted by compile_syntax(). Each next line gives the help string of
+        *   an argument as name: help string ; the lines starting with a space or a tab continue the help string of the previous line.
+        *   Empty lines and lines starting with # are ignored. The program name is set from the syntax.
         */
-        void load_from_file(const std::string& fname);      // TODO
+        std::string load_from_file(const std::string& fname);
 
         /*! \brief Saves the usage data to the given file.
         *   \param fname the name of the file to save
@@ -527,15 +1126,41 @@ namespace Usage
 
         /*! \brief Sets the syntax of the command line.
         *   \param syntax the string representing the syntax of the command line
-        *   \todo Build dependencies and conflicts from the command line syntax
+        *   \sa Usage::compile_syntax()
         */
         void set_syntax(const std::string& syntax);
 
+        /*! \brief Replaces the arguments and their rules by the ones described by a syntax string.
+        *   \param syntax the syntax of the command line, starting with the program name, as returned by get_syntax()
+        *   \param helpstrings the help strings of the arguments, by name
+        *   \return an empty string if succeeded, else the error found in the syntax or the name of a help string that is not an argument of the syntax ;
+        *   the usage is not modified in this case
+        *
+        *   Words are unnamed arguments, followed by ... if they accept many values. Named arguments start with the switch char and are simple,
+        *   boolean if followed by {+|-} or string if followed by :name ; a one char key followed by a name, or a char following the name and a
+        *   comma, is the shortcut of the argument.
+        *   Arguments delimited by [] are optional, the others are required, unless nested in an optional group. In a group delimited by [] or (), the arguments of a sequence require
+        *   its last argument, and the last arguments of the alternatives separated by | are in conflict.
+        *   The compiled forms of the last syntax strings are kept, so that compiling one of them again only creates the arguments.
+        */
+        std::string compile_syntax(const std::string& syntax, const std::unordered_map<std::string, std::string>& helpstrings = {});
+
         /*! \brief Checks if the syntax string has been set.
         *   \return true if the syntax of the command line has been set
         */
         bool syntax_is_valid() const noexcept { return m_syntax_valid; };
 
+        /*! \brief Gets the syntax of the command line.
+        *   \return the syntax set by set_syntax(), or else the syntax built from the arguments and their rules
+        *
+        *   Unnamed arguments are listed first, then the named arguments and finally the groups of arguments in conflict delimited by | .
+        *   Optional arguments are delimited by [] ; a dependent that has a single requirement is displayed before it, both delimited by () if the requirement is mandatory.
+        *   Arguments that require each other in a cycle are displayed once, from the first of them.
+        *   A string argument is displayed by its shortcut followed by its name, the other named arguments by their name followed by a comma and their shortcut.
+        *   The syntax is built once and kept until the arguments or the rules change.
+        */
+        const std::string& get_syntax();
+
         /*! \brief Checks the arguments passed to the program and assign their values.
         *   \param argc the number of arguments passed to the main executable
         *   \param argv an array of c-like strings passed to the main executable
@@ -548,15 +1173,190 @@ namespace Usage
         // returns the collection of <Argument, value> pairs corresponding to argv, with control of rules
         // returns "" if succeed, or the error message if it fails
 
+        /*! \brief Checks the arguments of a command line held in a buffer and assign their values.
+        *   \param buffer the arguments passed to the main executable, the program name first, each one followed by a null char as in /proc/<pid>/cmdline ;
+        *   the null char after the last argument may be omitted
+        *   \param size the size of the buffer in bytes
+        *   \return the same message as set_parameters(argc, argv)
+        *
+        *   The arguments are read in place from the buffer, no array of pointers is built.
+        */
+        std::string set_parameters(const char* buffer, size_t size);
+
+        /*! \brief Gets the reason of the fail of the last parsing.
+        *   \return Parse_Error::none if the last parsing succeeded
+        *   \sa Usage::snapshot()
+        */
+        Parse_Error error() const noexcept { return m_state.error; }
+
+        /*! \brief Checks the arguments passed to the program against several candidate usages and stops at the first one that accepts them.
+        *   \param candidates the usages to try, in order
+        *   \param argc the number of arguments passed to the main executable
+        *   \param argv an array of c-like strings passed to the main executable
+        *   \return the index of the first candidate for which set_parameters() returns an empty string or "?", or the number of candidates if none accepts the arguments
+        *
+        *   The command line is split once for each distinct setting of the limits, case_insensitive and of the help search among the candidates tried,
+        *   and the result is shared by the candidates with the same setting.
+        *   Each candidate tried keeps its result as if its set_parameters() function had been called.
+        */
+        static size_t set_parameters(const std::vector<Usage*>& candidates, int argc, char* argv[]);
+
+        /*! \brief Checks a batch of command lines without assigning their values to the arguments.
+        *   \param command_lines the command lines, each one as a list of arguments without the program name
+        *   \param mode the way the command lines are spread over the threads
+        *   \return the state of each command line, in the same order ; the message of each state is the one set_parameters() would return
+        *
+        *   The results are the same whatever the mode. A state can be assigned to the arguments with restore().
+        *   The usage must not be modified while the batch is processed.
+        */
+        std::vector<Parse_State> parse_batch(const std::vector<std::vector<std::string>>& command_lines, Batch_Mode mode = Batch_Mode::parallel);
+
+        /*! \brief Checks a batch of command lines and stores their values in a pool.
+        *   \param command_lines the command lines, each one as a list of arguments without the program name
+        *   \param pool the pool receiving the values, it can be shared by several batches
+        *   \param mode the way the command lines are spread over the threads
+        *   \return the state of each command line, in the same order, its values being identifiers in the pool
+        *
+        *   Each state gives its values to the pool as soon as it is checked, so identical values of the batch are stored once.
+        *   \sa Value_Pool::expand()
+        */
+        std::vector<Pooled_State> parse_batch(const std::vector<std::vector<std::string>>& command_lines, Value_Pool& pool, Batch_Mode mode = Batch_Mode::parallel);
+
+        /*! \brief Checks the command lines of the running processes of the program without assigning their values to the arguments.
+        *   \param mode the way the command lines are spread over the threads
+        *   \return the pid and the state of each process of the program, in the order of the pids ; all the processes are checked if the program name of the usage is empty
+        *
+        *   The names are compared without their paths and without a trailing .exe. A process runs the program if its first argument is the program,
+        *   or if it runs an interpreter and its first argument that is not an option (i.e. python3 -u tool.py) is the program ; the arguments of the program
+        *   are then the ones that follow it.
+        *   The command lines are read one after the other from /proc/<pid>/cmdline, then checked as a batch in the given mode ; the processes that can't
+        *   be read are skipped. The result is empty on systems without /proc.
+        *   The deprecated aliases found are reported in the states but not counted by get_deprecated_uses().
+        *   \sa Usage::parse_batch()
+        */
+        std::vector<Process_Audit> audit_processes(Batch_Mode mode = Batch_Mode::parallel);
+
+        /*! \brief Gets a copy of the state of the last parsing.
+        *   \return the values and flags of the arguments and the message of the last parsing
+        *
+        *   The state is copied in full, values included, so its cost grows with the number and the size of the values ; the state is not shared with the usage.
+        *   A state passed to restore() with std::move() is not copied again.
+        *   \sa Usage::restore()
+        */
+        Parse_State snapshot() const { return m_state; }
+
+        /*! \brief Restores a state returned by snapshot() and assigns its values to the arguments.
+        *   \param state the state to restore
+        *   \warning An assertion occurs if the state does not match the current list of arguments.
+        *   \sa Usage::snapshot()
+        */
+        void restore(Parse_State state);
+
+        /*! \brief Sets or changes the value of a named argument after a call to set_parameters().
+        *   \param arg the argument as it would be passed through the command line (i.e. /p:2)
+        *   \return the message that set_parameters() would return for the modified command line, or the reason why the argument is rejected (parameters are then left unchanged)
+        *
+        *   Only the types, requirements, conflicts and default values affected by the argument are checked again.
+        *   \warning An assertion occurs if set_parameters() has not been called since the last change of the arguments or rules.
+        *   \sa Usage::unset_parameter()
+        */
+        std::string set_parameter(const std::string& arg);
+
+        /*! \brief Removes an argument from the parameters after a call to set_parameters().
+        *   \param name the name of the argument to remove
+        *   \return the message that set_parameters() would return for the modified command line
+        *   \warning An assertion occurs if the argument name is unknown or if set_parameters() has not been called since the last change of the arguments or rules.
+        *   \sa Usage::set_parameter()
+        */
+        std::string unset_parameter(const std::string& name);
+
+        /*! \brief Gets the usage help laid out for the given width.
+        *   \param width the number of columns of the output, 0 to keep the lines of the help strings as they are
+        *   \return the usage help, the same as operator<< for a width of 0
+        *
+        *   The help strings are wrapped at spaces and their continuation lines are aligned on the first one ; the syntax is wrapped too.
+        *   The help is laid out once and kept until the arguments, the rules, the texts or the width change.
+        *   \sa Usage::terminal_width()
+        */
+        const std::string& help(size_t width = 0);
+
+        /*! \brief Gets the help of the arguments that match the searched words.
+        *   \param term the searched words, separated by spaces ; an argument matches if each word starts a word of its name or of its help string, case ignored
+        *   \param width the number of columns of the output, 0 to keep the lines of the help strings as they are
+        *   \return the help of the matching arguments laid out as by help(), in the order they were added ; empty if none matches
+        *
+        *   The words are searched in an index built on the first search and kept until the arguments or the rules change.
+        *   \sa Usage::help_term()
+        */
+        std::string search_help(const std::string& term, size_t width = 0);
+
+        /*! \brief Gets the words searched in the help through the command line.
+        *   \return the term passed as help argument followed by ':' and the term (i.e. -h:sort) if the last parsing returned "?", else an empty string
+        *
+        *   The search is not available if the help argument is also the name, the shortcut or an alias of an argument, which receives the term as value.
+        */
+        const std::string& help_term() const noexcept;
+
+        /*! \brief Gets the width of the terminal.
+        *   \return the value of the COLUMNS environment variable if set, else the width of the console on the standard output, else 0
+        */
+        static size_t terminal_width();
+
         /*! \brief Append the usage help to the given output stream.
         *   \param os the output stream
         *   \param us the usage instance for which the usage help must be appended
         * 
         *   Description is displayed first, then the command line syntax and arguments description.
         *   Finally the usage string is added to the output.
+        *   \sa Usage::help()
         */
         friend std::ostream& operator<<(std::ostream& os, Usage& us);
         // use to print usage help
+
+        friend class Parser;
+        friend class Default_Values;
+    };
+
+    /*! \brief The class Parser reads a command line pushed one argument at a time.
+
+        It allows to parse command lines coming from slow sources without buffering them: any number of parsers can be in progress on the same usage.
+        The result is not assigned to the arguments of the usage, restore() must be called for that.
+        The usage must not be modified while a parser is in progress.
+    */
+    class Parser
+    {
+    private:
+        Usage* m_usage;
+        Parse_State m_state{};
+        bool m_many{ false };
+        size_t m_unnamed{ 0 };
+        size_t m_position{ 0 };
+        size_t m_bytes{ 0 };
+        bool m_stopped{ false };
+        bool m_finished{ false };
+
+    public:
+        /*! \brief Starts the parsing of a command line.
+        *   \param usage the usage that defines the expected arguments
+        */
+        explicit Parser(Usage& usage);
+
+        /*! \brief Reads the next argument of the command line, the program name excluded.
+        *   \param arg the argument as it would be passed through the command line
+        *   \return false if the parsing is stopped by an error or a help request, the next arguments are then ignored
+        */
+        bool push(const std::string& arg);
+
+        /*! \brief Ends the command line and checks the rules.
+        *   \return the message that set_parameters() would return for the same command line
+        *
+        *   The uses of deprecated aliases are counted by the first call only, the next calls return the same message.
+        *   \sa Parser::state()
+        */
+        std::string finish();
+
+        /*! \brief Gets the state of the parsing, to be passed to Usage::restore() once finished. */
+        const Parse_State& state() const noexcept { return m_state; }
     };
 
 }
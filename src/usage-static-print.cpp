@@ -0,0 +1,310 @@
+/*! \file usage-static-print.cpp
+    \brief Defines the output of the arguments and of the usage help, kept apart so that the core library does not depend on iostreams.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <initializer_list>
+#include <iterator>
+#include <ostream>
+#include <string_view>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include <usage-static.hpp>
+
+namespace Usage
+{
+    std::ostream& operator<<(std::ostream& os, const Argument& arg)
+    {   // used to return the xml definition of the Argument
+        return arg.print(os);
+    }
+}
+
+std::ostream& Usage::Argument::print(std::ostream& os, const std::string& indent) const
+{
+    return named() ? m_print_named(os, indent) : m_print_unnamed(os, indent);
+}
+
+std::ostream& Usage::Argument::m_print_fields(std::ostream& os, const std::string& indent) const
+{
+    os << indent << "<name>" << m_name << "</name>" << std::endl;
+    os << indent << "<helpstring>" << helpstring << "</helpstring>" << std::endl;
+    os << indent << "<required>" << std::boolalpha << m_required << "</required>" << std::endl;
+    if (path_check != Path_Check::none)
+        os << indent << "<path_check>" << (int)path_check << "</path_check>" << std::endl;
+    if (check_utf8)
+        os << indent << "<check_utf8>" << std::boolalpha << check_utf8 << "</check_utf8>" << std::endl;
+    return os;
+}
+
+std::ostream& Usage::Argument::m_print_named(std::ostream& os, const std::string& indent) const
+{
+    auto& arg = static_cast<const Named_Arg&>(*this);
+    os << indent << "<named>" << std::endl;
+    m_print_fields(os, indent + "\t");
+    os << indent << "\t<shortcut_char>" << arg.shortcut_char << "</shortcut_char>" << std::endl;
+    os << indent << "\t<type>" << (int)arg.m_type << "</type>" << std::endl;
+    os << indent << "\t<default_value>" << arg.m_default_value << "</default_value>" << std::endl;
+    for (auto& choice : arg.m_choices)
+        os << indent << "\t<choice>" << choice << "</choice>" << std::endl;
+    if (arg.m_ranged)
+        os << indent << "\t<range>" << arg.m_min << ',' << arg.m_max << "</range>" << std::endl;
+    if (!arg.m_pattern.empty())
+        os << indent << "\t<pattern>" << arg.m_pattern << "</pattern>" << std::endl;
+    os << indent << "</named>" << std::endl;
+    return os;
+}
+
+std::ostream& Usage::Argument::m_print_unnamed(std::ostream& os, const std::string& indent) const
+{
+    auto& arg = static_cast<const Unnamed_Arg&>(*this);
+    os << indent << "<unnamed>" << std::endl;
+    m_print_fields(os, indent + "\t");
+    os << indent << "\t<many>" << std::boolalpha << arg.many << "</many>" << std::endl;
+    os << indent << "</unnamed>" << std::endl;
+    return os;
+}
+
+namespace
+{
+    // the lines are not wrapped when less than this number of columns is left for them
+    constexpr size_t MIN_WRAP_WIDTH{ 20 };
+
+    // appends the text followed by a new line, its lines wrapped at spaces to fit in width columns ; a word longer than the room left is split
+    // the first line continues the current one that is at column start, the next ones are indented by column spaces
+    void append_wrapped(std::string& out, std::string_view text, size_t start, size_t column, size_t width)
+    {
+        auto room_at = [width](size_t col) -> size_t { return width >= col + MIN_WRAP_WIDTH ? width - col : 0; };
+        auto room = room_at(start);         // 0 if the line is not wrapped
+        bool first{ true };
+        do
+        {
+            auto end = text.find('\n');
+            auto line = text.substr(0, end);
+            text = end == std::string_view::npos ? std::string_view{} : text.substr(end + 1);
+            do
+            {
+                auto cut = line.size();
+                auto next = cut;
+                bool wrapped{ room != 0 && cut > room };
+                if (wrapped)
+                {
+                    next = line.rfind(' ', room);
+                    if (next == std::string_view::npos || next == 0)
+                        next = room;
+                    cut = line.find_last_not_of(' ', next - 1) + 1;
+                    if (cut == 0)
+                        cut = next;
+                }
+                if (!first)
+                    out.append(column, ' ');
+                out.append(line.substr(0, cut));
+                out += '\n';
+                if (first)
+                {
+                    first = false;
+                    room = room_at(column);
+                }
+                line.remove_prefix(next);
+                if (wrapped)
+                    line.remove_prefix(std::min(line.size(), line.find_first_not_of(' ')));
+            } while (!line.empty());
+        } while (!text.empty());
+    }
+
+    // length of the name of the argument followed by its shortcut
+    size_t name_length(const Usage::Argument& arg)
+    {
+        auto lgth = arg.name().length();
+        if (arg.named() && static_cast<const Usage::Named_Arg&>(arg).shortcut_char != ' ')
+            lgth += 3;
+        return lgth;
+    }
+
+    // appends the name of the argument, its help string from column and its default value on a line of its own
+    void append_argument(std::string& out, Usage::Argument& arg, size_t column, size_t width)
+    {
+        auto line_start = out.size();
+        out.append("    ").append(arg.name());
+        if (arg.named() && static_cast<Usage::Named_Arg&>(arg).shortcut_char != ' ')
+            out.append(", ").append(1, static_cast<Usage::Named_Arg&>(arg).shortcut_char);
+        out.append(line_start + column - out.size(), ' ');
+        std::string text{ arg.helpstring };
+        if (arg.named())
+        {
+            auto dval = static_cast<Usage::Named_Arg&>(arg).default_value();
+            if (!dval.empty())
+            {
+                if (!text.empty() && text.back() != '\n')
+                    text += '\n';
+                text += '\'';
+                if (dval == "\t")
+                    text += "Tab";
+                else if (dval == " ")
+                    text += "Space";
+                else
+                    text += dval;
+                text += "' by default.";
+            }
+        }
+        if (text.empty())
+        {
+            out.resize(out.find_last_not_of(' ') + 1);
+            out += '\n';
+        }
+        else
+            append_wrapped(out, text, column, column, width);
+    }
+
+    // calls f for each word of the text, in lower case ; a word is a sequence of letters, digits and non ASCII chars
+    template<typename F>
+    void for_each_word(std::string_view text, F f)
+    {
+        std::string word{};
+        for (size_t i = 0; i <= text.size(); i++)
+        {
+            unsigned char c = i < text.size() ? text[i] : ' ';
+            if (std::isalnum(c) || c >= 0x80)
+                word += static_cast<char>(c >= 0x80 ? c : std::tolower(c));
+            else if (!word.empty())
+            {
+                f(word);
+                word.clear();
+            }
+        }
+    }
+
+    // checks that the texts separated by null chars are the given ones
+    bool same_texts(std::string_view texts, std::initializer_list<std::string_view> parts)
+    {
+        for (auto part : parts)
+        {
+            if (texts.size() < part.size() || texts.substr(0, part.size()) != part)
+                return false;
+            texts.remove_prefix(part.size());
+            if (texts.empty() || texts[0] != '\0')
+                return false;
+            texts.remove_prefix(1);
+        }
+        return texts.empty();
+    }
+}
+
+const std::string& Usage::Usage::help(size_t width)
+{
+    auto& syntax = get_syntax();
+    if (m_help_valid && m_help_width == width && same_texts(m_help_texts, { description, syntax, usage }))
+        return m_help;
+
+    // names are displayed in a column as wide as the longest one, help strings are displayed after it
+    // argsorder is used to list the elements in the same order they were added
+    size_t max_length{ 0 };
+    for (auto arg : m_argsorder)
+        max_length = std::max(max_length, name_length(*arg));
+    const size_t column{ 4 + max_length + 4 };
+
+    m_help.clear();
+    if (width == 0)
+        m_help.append(description).append("\n");
+    else
+        append_wrapped(m_help, description, 0, 0, width);
+    m_help.append("\nSyntax:\n    ");
+    append_wrapped(m_help, syntax, 4, 4 + program_name.size() + 1, width);
+    m_help += '\n';
+    for (auto arg : m_argsorder)
+        append_argument(m_help, *arg, column, width);
+    m_help += '\n';
+    if (width == 0)
+        m_help.append(usage).append("\n");
+    else
+        append_wrapped(m_help, usage, 0, 0, width);
+
+    m_help_texts.assign(description).append(1, '\0').append(syntax).append(1, '\0').append(usage).append(1, '\0');
+    m_help_width = width;
+    m_help_valid = true;
+    return m_help;
+}
+
+std::string Usage::Usage::search_help(const std::string& term, size_t width)
+{
+    if (!m_help_indexed)
+    {
+        m_help_index.clear();
+        for (size_t i = 0; i < m_argsorder.size(); i++)
+        {
+            auto add = [this, i](const std::string& word) { m_help_index.emplace_back(word, i); };
+            for_each_word(m_argsorder[i]->name(), add);
+            for_each_word(m_argsorder[i]->helpstring, add);
+        }
+        std::sort(m_help_index.begin(), m_help_index.end());
+        m_help_index.erase(std::unique(m_help_index.begin(), m_help_index.end()), m_help_index.end());
+        m_help_indexed = true;
+    }
+    // an argument matches if each word of the term starts one of its words
+    std::vector<size_t> matches{};
+    bool first{ true };
+    for_each_word(term, [&](const std::string& word) {
+        std::vector<size_t> found{};
+        for (auto itr = std::lower_bound(m_help_index.begin(), m_help_index.end(), word,
+            [](const std::pair<std::pmr::string, size_t>& entry, const std::string& key) { return entry.first.compare(key) < 0; });
+            itr != m_help_index.end() && (*itr).first.compare(0, word.size(), word) == 0; ++itr)
+            found.push_back((*itr).second);
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+        if (first)
+            matches = std::move(found);
+        else
+        {
+            std::vector<size_t> both{};
+            std::set_intersection(matches.begin(), matches.end(), found.begin(), found.end(), std::back_inserter(both));
+            matches = std::move(both);
+        }
+        first = false;
+    });
+
+    size_t max_length{ 0 };
+    for (auto i : matches)
+        max_length = std::max(max_length, name_length(*m_argsorder[i]));
+    std::string result{};
+    for (auto i : matches)
+        append_argument(result, *m_argsorder[i], 4 + max_length + 4, width);
+    return result;
+}
+
+size_t Usage::Usage::terminal_width()
+{
+    if (auto columns = std::getenv("COLUMNS"))
+    {
+        auto width = std::strtoul(columns, nullptr, 10);
+        if (width > 0)
+            return width;
+    }
+#if defined(_WIN32)
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+        return static_cast<size_t>(info.srWindow.Right - info.srWindow.Left + 1);
+#elif defined(__unix__) || defined(__APPLE__)
+    winsize size{};
+    if (isatty(STDOUT_FILENO) && ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0)
+        return size.ws_col;
+#endif
+    return 0;
+}
+
+namespace Usage
+{
+    std::ostream& operator<<(std::ostream& os, Usage& us)
+    {
+        return os << us.help() << std::flush;
+    }
+}
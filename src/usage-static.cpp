@@ -3,20 +3,961 @@
     \author Christophe COUAILLET
 */
 
+#include <algorithm>
 #include <array>
-#include <iostream>
+#include <atomic>
 #include <cassert>
-#include <sstream>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// builds without exceptions (-fno-exceptions, /EHs-c-) have no try blocks
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+#define USAGE_EXCEPTIONS
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USAGE_SSE2
+#include <emmintrin.h>
+#endif
+
+// SSSE3 and AVX2 versions of the UTF-8 check, selected at runtime for the CPU
+#if defined(USAGE_SSE2) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define USAGE_UTF8_SIMD
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define USAGE_TARGET(isa) __attribute__((target(isa)))
+#else
+#include <intrin.h>
+#define USAGE_TARGET(isa)
+#endif
+#endif
 
 #include <str-utils-static.hpp>
 #include <usage-static.hpp>
 
+struct Usage::Usage::Pattern
+{
+    std::regex regex;
+};
+
+void Usage::Usage::Pattern_Deleter::operator()(Pattern* pattern) const noexcept
+{
+    delete pattern;
+}
+
 static std::string AType_toStr(Usage::Argument_Type arg)
 {
     static const std::array<const std::string, 3> AType_Label{ "string", "boolean", "simple" };
     return AType_Label[(int)arg];
 }
 
+// returns the reason why the path does not pass the checks, nullptr if it passes
+static const char* path_error(const std::string& path, Usage::Path_Check checks)
+{
+    std::error_code ec;
+    auto status = std::filesystem::status(path, ec);
+    if (!std::filesystem::exists(status))
+        return "not found";         // all checks require the path to exist
+    if ((checks & Usage::Path_Check::is_file) != Usage::Path_Check::none && !std::filesystem::is_regular_file(status))
+        return "not a file";
+    if ((checks & Usage::Path_Check::is_dir) != Usage::Path_Check::none && !std::filesystem::is_directory(status))
+        return "not a directory";
+#ifdef _WIN32
+    if ((checks & Usage::Path_Check::readable) != Usage::Path_Check::none && _access(path.c_str(), 4) != 0)
+#else
+    if ((checks & Usage::Path_Check::readable) != Usage::Path_Check::none && access(path.c_str(), R_OK) != 0)
+#endif
+        return "not readable";
+    return nullptr;
+}
+
+// removes the quotes of the value and decodes the escape sequences \t, \n, \", \\ and \xHH found between quotes
+// stretches without quote or escape are copied in bulk
+static std::string unquote(const char* value, size_t size)
+{
+    auto hex_value = [](char c) { return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; };
+    auto end = value + size;
+    auto find = [end](const char* from, char c)
+    {
+        auto found = static_cast<const char*>(std::memchr(from, c, end - from));
+        return found != nullptr ? found : end;
+    };
+    std::string result{};
+    result.reserve(size);
+    auto p = value;
+    const char* next_quote{ nullptr };
+    const char* next_escape{ nullptr };
+    bool quoted{ false };
+    while (p < end)
+    {
+        if (next_quote == nullptr || next_quote < p)
+            next_quote = find(p, '\"');
+        if (!quoted)
+        {
+            // outside quotes, backslashes are kept as is (i.e. Windows paths)
+            result.append(p, next_quote - p);
+            p = next_quote + 1;
+            quoted = true;
+            continue;
+        }
+        if (next_escape == nullptr || next_escape < p)
+            next_escape = find(p, '\\');
+        auto stop = std::min(next_quote, next_escape);
+        result.append(p, stop - p);
+        if (stop == end)
+            break;
+        p = stop + 1;
+        if (*stop == '\"')
+        {
+            quoted = false;
+            continue;
+        }
+        if (p == end)
+        {
+            result += '\\';
+            break;
+        }
+        switch (*p)
+        {
+        case 't':
+            result += '\t';
+            break;
+        case 'n':
+            result += '\n';
+            break;
+        case '\"':
+        case '\\':
+            result += *p;
+            break;
+        case 'x':
+            if (end - p > 2 && std::isxdigit((unsigned char)p[1]) && std::isxdigit((unsigned char)p[2]))
+            {
+                result += (char)(hex_value(p[1]) * 16 + hex_value(p[2]));
+                p += 2;
+                break;
+            }
+            [[fallthrough]];
+        default:
+            // unknown sequences are kept as is
+            result += '\\';
+            result += *p;
+        }
+        ++p;
+    }
+    return result;
+}
+
+// number of arguments from which the components of a usage are checked on several threads
+static const size_t PARALLEL_MIN_ARGUMENTS{ 4096 };
+
+// bounded single producer / single consumer queue, used to chain the stages of a pipeline ; the values are moved in and out in order
+template<typename T>
+class Stage_Ring
+{
+public:
+    void push(T value)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        while (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+            std::this_thread::yield();
+        m_slots[tail % m_slots.size()] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+    }
+
+    T pop()
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        while (m_tail.load(std::memory_order_acquire) == head)
+            std::this_thread::yield();
+        auto value = std::move(m_slots[head % m_slots.size()]);
+        m_head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+private:
+    std::array<T, 256> m_slots{};
+    // head and tail are kept on distinct cache lines
+    alignas(64) std::atomic<size_t> m_head{ 0 };
+    alignas(64) std::atomic<size_t> m_tail{ 0 };
+};
+
+// converts the ASCII upper case letters to lower case in place, the other bytes are left unchanged
+// 16 bytes are folded at once with SSE2, then 8 bytes at once in a 64-bit word
+static void fold_ascii(char* text, size_t size)
+{
+    size_t i{ 0 };
+#ifdef USAGE_SSE2
+    const __m128i before_a = _mm_set1_epi8('A' - 1);
+    const __m128i after_z = _mm_set1_epi8('Z' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16)
+    {
+        // bytes above 0x7F are negative, so they are never in the range
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        auto upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_a), _mm_cmplt_epi8(chunk, after_z));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(text + i), _mm_or_si128(chunk, _mm_and_si128(upper, case_bit)));
+    }
+#endif
+    constexpr std::uint64_t ONES{ 0x0101010101010101ULL };
+    constexpr std::uint64_t HIGH_BITS{ 0x8080808080808080ULL };
+    for (; i + 8 <= size; i += 8)
+    {
+        // the high bit of each byte is set by the additions if the low 7 bits are above 'Z', or at least 'A'
+        std::uint64_t word;
+        std::memcpy(&word, text + i, 8);
+        auto low_bits = word & ~HIGH_BITS;
+        auto above_z = low_bits + ONES * (0x7F - 'Z');
+        auto from_a = low_bits + ONES * (0x80 - 'A');
+        auto upper = ~word & (from_a ^ above_z) & HIGH_BITS;
+        word |= upper >> 2;
+        std::memcpy(text + i, &word, 8);
+    }
+    for (; i < size; i++)
+    {
+        if (text[i] >= 'A' && text[i] <= 'Z')
+            text[i] |= 0x20;
+    }
+}
+
+#ifdef USAGE_UTF8_SIMD
+// errors found from the high and low nibbles of a byte and the high nibble of the next one, as described by J. Keiser and D. Lemire in
+// "Validating UTF-8 in less than one instruction per byte" (2021) ; a pair of bytes is invalid if the three lookups share a bit
+constexpr std::uint8_t UTF8_TOO_SHORT{ 1 << 0 };       // lead byte not followed by a continuation byte
+constexpr std::uint8_t UTF8_TOO_LONG{ 1 << 1 };        // ASCII byte followed by a continuation byte
+constexpr std::uint8_t UTF8_OVERLONG_3{ 1 << 2 };
+constexpr std::uint8_t UTF8_TOO_LARGE{ 1 << 3 };
+constexpr std::uint8_t UTF8_SURROGATE{ 1 << 4 };
+constexpr std::uint8_t UTF8_OVERLONG_2{ 1 << 5 };
+constexpr std::uint8_t UTF8_TOO_LARGE_1000{ 1 << 6 };
+constexpr std::uint8_t UTF8_OVERLONG_4{ 1 << 6 };
+constexpr std::uint8_t UTF8_TWO_CONTS{ 1 << 7 };       // continuation byte following a continuation byte, valid in 3 and 4 byte sequences only
+constexpr std::uint8_t UTF8_CARRY{ UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS };
+
+alignas(16) static const std::uint8_t UTF8_BYTE_1_HIGH[16]{
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+alignas(16) static const std::uint8_t UTF8_BYTE_1_LOW[16]{
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+alignas(16) static const std::uint8_t UTF8_BYTE_2_HIGH[16]{
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+// greatest values of the last bytes of a block whose sequences are complete
+alignas(32) static const std::uint8_t UTF8_MAX_LAST[32]{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF
+};
+
+// errors of a block of 16 bytes, given the previous block
+USAGE_TARGET("ssse3") static inline __m128i utf8_block_errors(__m128i input, __m128i prev)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    auto prev1 = _mm_alignr_epi8(input, prev, 15);
+    auto byte_1_high = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_1_HIGH)), _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    auto byte_1_low = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_1_LOW)), _mm_and_si128(prev1, nibble));
+    auto byte_2_high = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_2_HIGH)), _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    auto special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+    // the third and fourth bytes of a sequence must be continuation bytes, and the only ones allowed after a continuation byte
+    auto third = _mm_subs_epu8(_mm_alignr_epi8(input, prev, 14), _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    auto fourth = _mm_subs_epu8(_mm_alignr_epi8(input, prev, 13), _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    auto must_continue = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+    return _mm_xor_si128(must_continue, special);
+}
+
+// a lookup table in both lanes
+USAGE_TARGET("avx2") static inline __m256i utf8_table(const std::uint8_t* bytes)
+{
+    return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(bytes)));
+}
+
+// errors of a block of 32 bytes, given the previous block
+USAGE_TARGET("avx2") static inline __m256i utf8_block_errors(__m256i input, __m256i prev)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    // the last bytes of the previous block followed by the first bytes of the input, in each lane
+    auto shifted = _mm256_permute2x128_si256(prev, input, 0x21);
+    auto prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    auto byte_1_high = _mm256_shuffle_epi8(utf8_table(UTF8_BYTE_1_HIGH), _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    auto byte_1_low = _mm256_shuffle_epi8(utf8_table(UTF8_BYTE_1_LOW), _mm256_and_si256(prev1, nibble));
+    auto byte_2_high = _mm256_shuffle_epi8(utf8_table(UTF8_BYTE_2_HIGH), _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    auto special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+    auto third = _mm256_subs_epu8(_mm256_alignr_epi8(input, shifted, 14), _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    auto fourth = _mm256_subs_epu8(_mm256_alignr_epi8(input, shifted, 13), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    auto must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+    return _mm256_xor_si256(must_continue, special);
+}
+
+// true if the text is valid UTF-8 ; the last block is padded with zeros, so that a sequence cut by the end of the text is an error
+USAGE_TARGET("ssse3") static bool utf8_valid_ssse3(const unsigned char* s, size_t size)
+{
+    const __m128i max_last = _mm_load_si128(reinterpret_cast<const __m128i*>(UTF8_MAX_LAST + 16));
+    __m128i error = _mm_setzero_si128();
+    __m128i prev = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    size_t i{ 0 };
+    for (; i + 16 <= size; i += 16)
+    {
+        auto input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            // an ASCII block is only invalid if the previous one ends with a cut sequence
+            error = _mm_or_si128(error, incomplete);
+            incomplete = _mm_setzero_si128();
+        }
+        else
+        {
+            error = _mm_or_si128(error, utf8_block_errors(input, prev));
+            incomplete = _mm_subs_epu8(input, max_last);
+        }
+        prev = input;
+    }
+    alignas(16) unsigned char last[16]{};
+    std::memcpy(last, s + i, size - i);
+    error = _mm_or_si128(error, utf8_block_errors(_mm_load_si128(reinterpret_cast<const __m128i*>(last)), prev));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+USAGE_TARGET("avx2") static bool utf8_valid_avx2(const unsigned char* s, size_t size)
+{
+    const __m256i max_last = _mm256_load_si256(reinterpret_cast<const __m256i*>(UTF8_MAX_LAST));
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    size_t i{ 0 };
+    for (; i + 32 <= size; i += 32)
+    {
+        auto input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        if (_mm256_movemask_epi8(input) == 0)
+        {
+            error = _mm256_or_si256(error, incomplete);
+            incomplete = _mm256_setzero_si256();
+        }
+        else
+        {
+            error = _mm256_or_si256(error, utf8_block_errors(input, prev));
+            incomplete = _mm256_subs_epu8(input, max_last);
+        }
+        prev = input;
+    }
+    alignas(32) unsigned char last[32]{};
+    std::memcpy(last, s + i, size - i);
+    error = _mm256_or_si256(error, utf8_block_errors(_mm256_load_si256(reinterpret_cast<const __m256i*>(last)), prev));
+    return _mm256_testz_si256(error, error) != 0;
+}
+
+// the widest check the CPU supports, nullptr if it supports none of them
+static bool (*utf8_validator())(const unsigned char*, size_t)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return utf8_valid_avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        return utf8_valid_ssse3;
+#else
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf{ info[0] };
+    __cpuid(info, 1);
+    bool ssse3{ (info[2] & (1 << 9)) != 0 };
+    // AVX registers must be saved by the OS
+    bool avx{ (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6 };
+    if (avx && max_leaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 5)) != 0)
+            return utf8_valid_avx2;
+    }
+    if (ssse3)
+        return utf8_valid_ssse3;
+#endif
+    return nullptr;
+}
+#endif
+
+// returns the offset of the first byte that does not belong to a valid UTF-8 sequence, or size if the text is valid
+// overlong encodings, surrogates and code points above U+10FFFF are rejected
+static size_t utf8_error(const char* text, size_t size)
+{
+    auto s = reinterpret_cast<const unsigned char*>(text);
+#ifdef USAGE_UTF8_SIMD
+    // long values are checked by the vector code, which only tells if they are valid ; the offset of the error is found by the loop below
+    static const auto valid = utf8_validator();
+    static constexpr size_t SIMD_MIN_SIZE{ 64 };
+    if (valid != nullptr && size >= SIMD_MIN_SIZE && valid(s, size))
+        return size;
+#endif
+    size_t i{ 0 };
+    while (i < size)
+    {
+        // ASCII stretches are skipped 16 or 8 bytes at a time
+#ifdef USAGE_SSE2
+        while (size - i >= 16 && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i))) == 0)
+            i += 16;
+#endif
+        while (size - i >= 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, s + i, 8);
+            if ((word & 0x8080808080808080ULL) != 0)
+                break;
+            i += 8;
+        }
+        while (i < size && s[i] < 0x80)
+            i++;
+        if (i == size)
+            break;
+        auto c = s[i];
+        size_t length;
+        unsigned char low{ 0x80 };
+        unsigned char high{ 0xBF };
+        if (c >= 0xC2 && c <= 0xDF)
+            length = 1;
+        else if (c == 0xE0)
+        {
+            length = 2;
+            low = 0xA0;
+        }
+        else if (c == 0xED)
+        {
+            length = 2;
+            high = 0x9F;
+        }
+        else if (c >= 0xE1 && c <= 0xEF)
+            length = 2;
+        else if (c == 0xF0)
+        {
+            length = 3;
+            low = 0x90;
+        }
+        else if (c >= 0xF1 && c <= 0xF3)
+            length = 3;
+        else if (c == 0xF4)
+        {
+            length = 3;
+            high = 0x8F;
+        }
+        else
+            return i;
+        if (size - i - 1 < length || s[i + 1] < low || s[i + 1] > high)
+            return i;
+        for (size_t k = 2; k <= length; k++)
+            if ((s[i + k] & 0xC0) != 0x80)
+                return i;
+        i += length + 1;
+    }
+    return size;
+}
+
+// arguments and rules read from a syntax string, shared by all the usages compiled from the same string
+struct Syntax_Table
+{
+    struct Spec
+    {
+        std::string name{};
+        bool named{ false };
+        char shortcut{ ' ' };
+        Usage::Argument_Type type{ Usage::Argument_Type::simple };
+        bool many{ false };
+        bool required{ false };
+    };
+    std::vector<Spec> arguments{};
+    std::vector<std::pair<size_t, size_t>> requirements{};      // dependent and requirement
+    std::vector<std::pair<size_t, size_t>> conflicts{};
+    std::unordered_map<std::string, size_t> names{};            // index of each argument by name
+    std::string error{};
+};
+
+// recursive descent parser of a syntax string:
+//   word      := name | name... | switch key | switch key{+|-} | switch key:name ; a key is a name, optionally followed by a comma and its shortcut
+//   sequence  := element { element } ; the elements of a group sequence require its last element
+//   group     := sequence { | sequence } ; the last elements of the alternatives are in conflict
+//   element   := word | [ group ] | ( group )
+class Syntax_Compiler
+{
+public:
+    Syntax_Compiler(const std::string& syntax, char switch_char) : m_syntax{ syntax }, m_switch{ switch_char } {}
+
+    Syntax_Table compile()
+    {
+        // the first word is the program name
+        m_skip_spaces();
+        while (m_pos < m_syntax.size() && !std::isspace((unsigned char)m_syntax[m_pos]))
+            m_pos++;
+        m_group('\0', true, 0);
+        return std::move(m_table);
+    }
+
+private:
+    static constexpr size_t NONE{ SIZE_MAX };
+    static constexpr size_t MAX_DEPTH{ 64 };
+
+    const std::string& m_syntax;
+    char m_switch;
+    size_t m_pos{ 0 };
+    Syntax_Table m_table{};
+    std::unordered_map<std::string, size_t> m_names{};
+
+    size_t m_fail(const std::string& error)
+    {
+        if (m_table.error.empty())
+            m_table.error = str_utils::get_message("Syntax error at position %zu: %s", m_pos + 1, error.c_str());
+        m_pos = m_syntax.size();
+        return NONE;
+    }
+
+    void m_skip_spaces()
+    {
+        while (m_pos < m_syntax.size() && std::isspace((unsigned char)m_syntax[m_pos]))
+            m_pos++;
+    }
+
+    // returns the head of the group, NONE if the group has several alternatives
+    size_t m_group(char close, bool required, size_t depth)
+    {
+        if (depth > MAX_DEPTH)
+            return m_fail("too many nested groups");
+        std::vector<size_t> heads{};
+        std::vector<size_t> sequence{};
+        auto end_alternative = [&]()
+        {
+            if (sequence.empty())
+            {
+                m_fail("empty alternative");
+                return false;
+            }
+            auto head = sequence.back();
+            for (size_t k = 0; close != '\0' && head != NONE && k + 1 < sequence.size(); k++)
+                if (sequence[k] != NONE)
+                    m_table.requirements.push_back({ sequence[k], head });
+            heads.push_back(head);
+            sequence.clear();
+            return true;
+        };
+        while (m_table.error.empty())
+        {
+            m_skip_spaces();
+            if (m_pos == m_syntax.size())
+            {
+                if (close != '\0')
+                    return m_fail(std::string{ "missing '" } + close + "'");
+                break;
+            }
+            auto c = m_syntax[m_pos];
+            if (c == ']' || c == ')')
+            {
+                if (c != close)
+                    return m_fail(std::string{ "unexpected '" } + c + "'");
+                m_pos++;
+                break;
+            }
+            if (c == '|')
+            {
+                if (!end_alternative())
+                    return NONE;
+                m_pos++;
+            }
+            else if (c == '[' || c == '(')
+            {
+                m_pos++;
+                // the arguments of a required group nested in an optional one are optional
+                sequence.push_back(m_group(c == '[' ? ']' : ')', c == '(' && required, depth + 1));
+            }
+            else
+                sequence.push_back(m_word(required));
+        }
+        if (!m_table.error.empty())
+            return NONE;
+        if (sequence.empty() && heads.empty())
+            return close == '\0' ? NONE : m_fail("empty group");
+        if (!end_alternative())
+            return NONE;
+        if (heads.size() == 1)
+            return heads[0];
+        for (size_t k = 0; k + 1 < heads.size(); k++)
+        {
+            if (heads[k] == NONE || heads[k + 1] == NONE)
+                return m_fail("alternatives cannot be nested");
+            if (m_table.arguments[heads[k]].required != m_table.arguments[heads[k + 1]].required)
+                return m_fail("arguments in conflict must be either all required or all optional");
+            m_table.conflicts.push_back({ heads[k], heads[k + 1] });
+        }
+        return NONE;
+    }
+
+    size_t m_word(bool required)
+    {
+        static const std::string DELIMITERS{ "[]()|{" };
+        auto start = m_pos;
+        while (m_pos < m_syntax.size() && !std::isspace((unsigned char)m_syntax[m_pos]) && DELIMITERS.find(m_syntax[m_pos]) == std::string::npos)
+            m_pos++;
+        std::string word{ m_syntax.substr(start, m_pos - start) };
+        Syntax_Table::Spec spec{};
+        spec.required = required;
+        if (word.empty())
+            return m_fail("argument expected");
+        if (word[0] == m_switch)
+        {
+            spec.named = true;
+            auto body = word.substr(1);
+            auto colon = body.find(':');
+            if (m_syntax.compare(m_pos, 5, "{+|-}") == 0)
+            {
+                if (colon != std::string::npos)
+                    return m_fail("a boolean argument cannot receive a value");
+                spec.type = Usage::Argument_Type::boolean;
+                m_pos += 5;
+            }
+            std::string placeholder{};
+            if (colon != std::string::npos)
+            {
+                spec.type = Usage::Argument_Type::string;
+                placeholder = body.substr(colon + 1);
+                body.erase(colon);
+            }
+            // a name followed by a comma and a char gives the shortcut
+            auto comma = body.find(',');
+            if (comma != std::string::npos)
+            {
+                if (comma == 0 || body.size() - comma != 2)
+                    return m_fail("one char shortcut expected after the name");
+                spec.shortcut = body.back();
+                body.erase(comma);
+            }
+            if (body.empty())
+                return m_fail("argument name expected");
+            if (spec.shortcut != ' ')
+                spec.name = body;
+            // a one char key followed by a name is a shortcut
+            else if (body.size() == 1 && !placeholder.empty() && placeholder != body)
+            {
+                spec.shortcut = body[0];
+                spec.name = placeholder;
+            }
+            else
+                spec.name = body;
+            if (spec.shortcut != ' ' && m_names.find(std::string{ m_switch } + spec.shortcut) != m_names.end())
+                return m_fail("shortcut '" + std::string{ spec.shortcut } + "' is already used");
+        }
+        else
+        {
+            if (word.size() > 3 && word.compare(word.size() - 3, 3, "...") == 0)
+            {
+                spec.many = true;
+                word.erase(word.size() - 3);
+            }
+            spec.name = word;
+        }
+        if (m_names.find(spec.name) != m_names.end())
+            return m_fail("argument '" + spec.name + "' is already defined");
+        m_names.emplace(spec.name, m_table.arguments.size());
+        m_table.names.emplace(spec.name, m_table.arguments.size());
+        if (spec.shortcut != ' ')
+            m_names.emplace(std::string{ m_switch } + spec.shortcut, m_table.arguments.size());
+        m_table.arguments.push_back(spec);
+        return m_table.arguments.size() - 1;
+    }
+};
+
+// the last compiled syntax strings, by switch char and syntax ; the oldest one is dropped when the cache is full
+static std::shared_ptr<const Syntax_Table> compiled_syntax(const std::string& syntax, char switch_char)
+{
+    static constexpr size_t MAX_CACHED{ 64 };
+    static std::mutex mutex{};
+    static std::unordered_map<std::string, std::shared_ptr<const Syntax_Table>> cache{};
+    static std::deque<std::string> order{};
+    std::string key{ switch_char + syntax };
+    std::lock_guard<std::mutex> lock{ mutex };
+    auto itr = cache.find(key);
+    if (itr != cache.end())
+        return (*itr).second;
+    auto table = std::make_shared<const Syntax_Table>(Syntax_Compiler{ syntax, switch_char }.compile());
+    if (order.size() == MAX_CACHED)
+    {
+        cache.erase(order.front());
+        order.pop_front();
+    }
+    cache.emplace(key, table);
+    order.push_back(std::move(key));
+    return table;
+}
+
+// name of a program without its path and without a trailing .exe, whatever its case
+static std::string_view program_stem(std::string_view path)
+{
+    auto slash = path.find_last_of("/\\");
+    if (slash != std::string_view::npos)
+        path.remove_prefix(slash + 1);
+    if (path.size() > 4 && path[path.size() - 4] == '.' && std::tolower((unsigned char)path[path.size() - 3]) == 'e'
+        && std::tolower((unsigned char)path[path.size() - 2]) == 'x' && std::tolower((unsigned char)path[path.size() - 1]) == 'e')
+        path.remove_suffix(4);
+    return path;
+}
+
+static bool has_wildcard(const std::string& value)
+{
+    return value.find_first_of("*?[") != std::string::npos;
+}
+
+// matches a file name against a pattern made of *, ? and [...] wildcards
+static bool glob_match(const char* pattern, const char* name)
+{
+    const char* star{ nullptr };
+    const char* retry{ nullptr };
+    while (*name != '\0')
+    {
+        if (*pattern == '*')
+        {
+            star = ++pattern;
+            retry = name;
+            continue;
+        }
+        bool match{ false };
+        const char* next{ pattern + 1 };
+        if (*pattern == '?')
+            match = true;
+        else if (*pattern == '[')
+        {
+            auto p = pattern + 1;
+            bool negate{ *p == '!' || *p == '^' };
+            if (negate)
+                ++p;
+            bool in_set{ false };
+            // a closing bracket in first position is a member of the set
+            for (auto first = p; *p != '\0' && (*p != ']' || p == first); ++p)
+            {
+                if (p[1] == '-' && p[2] != ']' && p[2] != '\0')
+                {
+                    if (*p <= *name && *name <= p[2])
+                        in_set = true;
+                    p += 2;
+                }
+                else if (*p == *name)
+                    in_set = true;
+            }
+            if (*p == ']')
+            {
+                match = in_set != negate;
+                next = p + 1;
+            }
+            else
+                match = *pattern == *name;          // unterminated set: literal bracket
+        }
+        else
+            match = *pattern == *name;
+        if (match)
+        {
+            pattern = next;
+            ++name;
+        }
+        else if (star != nullptr)
+        {
+            pattern = star;
+            name = ++retry;
+        }
+        else
+            return false;
+    }
+    while (*pattern == '*')
+        ++pattern;
+    return *pattern == '\0';
+}
+
+// expands the wildcards of a path pattern ; subdirectories are walked by a pool of threads and the matching paths are sorted
+// the walk stops as soon as more than limit paths match
+static std::vector<std::string> glob_expand(const std::string& pattern, size_t limit, bool parallel)
+{
+    namespace fs = std::filesystem;
+#ifdef _WIN32
+    static const char* separators{ "/\\" };
+#else
+    static const char* separators{ "/" };
+#endif
+    // split the pattern into path components ; literal leading components give the root of the walk
+    std::vector<std::string> parts{};
+    std::vector<size_t> offsets{};
+    size_t start{ 0 };
+    while (start <= pattern.size())
+    {
+        auto end = pattern.find_first_of(separators, start);
+        if (end == std::string::npos)
+            end = pattern.size();
+        if (end > start)
+        {
+            parts.push_back(pattern.substr(start, end - start));
+            offsets.push_back(start);
+        }
+        start = end + 1;
+    }
+    size_t first{ 0 };
+    while (first < parts.size() && !has_wildcard(parts[first]))
+        first++;
+    if (first == parts.size())
+        return {};
+    fs::path root{ pattern.substr(0, offsets[first]) };
+
+    struct Job
+    {
+        fs::path dir;
+        size_t part;
+    };
+    std::deque<Job> jobs{ { root, first } };
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    size_t active{ 0 };
+    // the matches are deduplicated as they are found, the walk stops when more distinct matches than the limit are found
+    std::atomic<size_t> matches{ 0 };
+    std::set<std::string> result{};
+
+    // adds the matches found to the result, the mutex being locked
+    auto merge = [&](std::vector<std::string>& found)
+    {
+        for (auto& path : found)
+            result.insert(std::move(path));
+        found.clear();
+        matches = result.size();
+    };
+
+    auto walk = [&]()
+    {
+        std::vector<std::string> found{};
+        std::vector<Job> pending{};
+        std::unique_lock<std::mutex> lock{ mutex };
+        while (true)
+        {
+            if (matches > limit)
+            {
+                jobs.clear();
+                cv.notify_all();
+                break;
+            }
+            cv.wait(lock, [&]() { return !jobs.empty() || active == 0; });
+            if (jobs.empty())
+                break;
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            active++;
+            lock.unlock();
+            auto& part = parts[job.part];
+            bool last{ job.part + 1 == parts.size() };
+            std::error_code ec;
+            if (part == "**")
+            {
+                // matches zero or more directories, or every entry below the directory if it is the last part
+                if (!last)
+                    pending.push_back({ job.dir, job.part + 1 });
+            }
+            else if (!has_wildcard(part))
+            {
+                auto path = job.dir / part;
+                if (fs::exists(path, ec))
+                {
+                    if (last)
+                        found.push_back(path.string());
+                    else
+                        pending.push_back({ path, job.part + 1 });
+                }
+            }
+            // the directory is only read for the wildcards
+            fs::directory_iterator itr{};
+            if (part == "**" || has_wildcard(part))
+                itr = fs::directory_iterator{ job.dir.empty() ? fs::path{ "." } : job.dir, fs::directory_options::skip_permission_denied, ec };
+            for (; !ec && itr != fs::directory_iterator{}; itr.increment(ec))
+            {
+                if (matches + found.size() > limit)
+                {
+                    // the matches may be duplicates, they are counted once merged
+                    std::lock_guard<std::mutex> guard{ mutex };
+                    merge(found);
+                    if (matches > limit)
+                        break;
+                }
+                auto name = itr->path().filename().string();
+                // as in shells, hidden entries match only patterns starting with a dot
+                if (name[0] == '.' && part[0] != '.')
+                    continue;
+                auto path = job.dir / name;
+                bool dir{ itr->is_directory(ec) && !itr->is_symlink(ec) };
+                if (part == "**")
+                {
+                    if (last)
+                        found.push_back(path.string());
+                    if (dir)
+                        pending.push_back({ path, job.part });
+                }
+                else if (glob_match(part.c_str(), name.c_str()))
+                {
+                    if (last)
+                        found.push_back(path.string());
+                    else if (dir)
+                        pending.push_back({ path, job.part + 1 });
+                }
+            }
+            lock.lock();
+            merge(found);
+            for (auto& next : pending)
+                jobs.push_back(std::move(next));
+            pending.clear();
+            active--;
+            cv.notify_all();
+        }
+    };
+
+    // a single thread walks the directories when the caller already runs in parallel
+    std::vector<std::thread> pool{};
+    auto threads = parallel ? std::max(1u, std::thread::hardware_concurrency()) : 1u;
+    for (unsigned t = 1; t < threads; t++)
+        pool.emplace_back(walk);
+    walk();
+    for (auto& thread : pool)
+        thread.join();
+    return { std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()) };
+}
+
 Usage::Argument::Argument(const std::string& name)
 {
     m_name = name;
@@ -27,6 +968,8 @@ Usage::Argument::Argument(const Argument& argument)
     m_name = argument.m_name;
     m_required = argument.m_required;
     helpstring = argument.helpstring;
+    path_check = argument.path_check;
+    check_utf8 = argument.check_utf8;
     for (auto val : argument.value)
         value.push_back(val);
 }
@@ -36,36 +979,28 @@ Usage::Argument::Argument(const Argument* argument)
     m_name = argument->m_name;
     m_required = argument->m_required;
     helpstring = argument->helpstring;
+    path_check = argument->path_check;
+    check_utf8 = argument->check_utf8;
     for (auto val : argument->value)
         value.push_back(val);
 }
 
-std::string Usage::Argument::name() const noexcept
+const std::string& Usage::Argument::name() const noexcept
 {
     return m_name;
 }
 
-namespace Usage
-{
-    std::ostream& operator<<(std::ostream& os, const Argument& arg)
-    {   // used to return the xml definition of the Argument
-        return arg.print(os);
-    }
-}
-
-std::ostream& Usage::Argument::print(std::ostream& os, const std::string& indent) const
-{
-    os << indent << "<name>" << m_name << "</name>" << std::endl;
-    os << indent << "<helpstring>" << helpstring << "</helpstring>" << std::endl;
-    os << indent << "<required>" << std::boolalpha << m_required << "</required>" << std::endl;
-    return os;
-}
-
 Usage::Named_Arg::Named_Arg(const Named_Arg& argument) : Argument(argument)
 {
     shortcut_char = argument.shortcut_char;
     m_type = argument.m_type;
     m_default_value = argument.m_default_value;
+    m_default_function = argument.m_default_function;
+    m_choices = argument.m_choices;
+    m_ranged = argument.m_ranged;
+    m_min = argument.m_min;
+    m_max = argument.m_max;
+    m_pattern = argument.m_pattern;
 }
 
 Usage::Named_Arg::Named_Arg(const Named_Arg* argument) : Argument(argument)
@@ -73,95 +1008,162 @@ Usage::Named_Arg::Named_Arg(const Named_Arg* argument) : Argument(argument)
     shortcut_char = argument->shortcut_char;
     m_type = argument->m_type;
     m_default_value = argument->m_default_value;
-}
-
-std::ostream& Usage::Named_Arg::print(std::ostream& os, const std::string& indent) const
-{
-    os << indent << "<named>" << std::endl;
-    Argument::print(os, indent + "\t");
-    os << indent << "\t<shortcut_char>" << shortcut_char << "</shortcut_char>" << std::endl;
-    os << indent << "\t<type>" << (int)m_type << "</type>" << std::endl;
-    os << indent << "\t<default_value>" << m_default_value << "</default_value>" << std::endl;
-    os << indent << "</named>" << std::endl;
-    return os;
-}
-
-std::ostream& Usage::Unnamed_Arg::print(std::ostream& os, const std::string& indent) const
-{
-    os << indent << "<unnamed>" << std::endl;
-    Argument::print(os, indent + "\t");
-    os << indent << "\t<many>" << std::boolalpha << many << "</many>" << std::endl;
-    os << indent << "</unnamed>" << std::endl;
-    return os;
+    m_default_function = argument->m_default_function;
+    m_choices = argument->m_choices;
+    m_ranged = argument->m_ranged;
+    m_min = argument->m_min;
+    m_max = argument->m_max;
+    m_pattern = argument->m_pattern;
 }
 
 void Usage::Named_Arg::set_required(const bool required)
 {
-    assert((!required || required && m_default_value.empty()) && "An argument can't be required if it defines a default value.");
+    assert((!required || (required && m_default_value.empty() && !m_default_function)) && "An argument can't be required if it defines a default value.");
     m_required = required;
 }
 
 void Usage::Named_Arg::set_type(Argument_Type type)
 {
-    assert((type != Argument_Type::simple || type == Argument_Type::simple && m_default_value.empty()) && "Type simple can't be set for arguments with a default value.");
+    assert((type != Argument_Type::simple || (type == Argument_Type::simple && m_default_value.empty() && !m_default_function)) && "Type simple can't be set for arguments with a default value.");
     m_type = type;
 }
 
 void Usage::Named_Arg::set_default_value(const std::string& default_value)
 {
-    assert((default_value.empty() || !default_value.empty() && !m_required) && "A default value can't be set for a required argument.");
-    assert((default_value.empty() || !default_value.empty() && m_type != Argument_Type::simple) && "A default value can't be set for an argument of type simple.");
+    assert((default_value.empty() || (!default_value.empty() && !m_required)) && "A default value can't be set for a required argument.");
+    assert((default_value.empty() || (!default_value.empty() && m_type != Argument_Type::simple)) && "A default value can't be set for an argument of type simple.");
     m_default_value = default_value;
+    m_default_function = nullptr;
 }
 
-Usage::Usage::Usage(const std::string& prog_name)
+void Usage::Named_Arg::set_default_value(Default_Function function)
 {
-    program_name = prog_name;
+    assert((!function || !m_required) && "A default value can't be set for a required argument.");
+    assert((!function || m_type != Argument_Type::simple) && "A default value can't be set for an argument of type simple.");
+    m_default_value.clear();
+    m_default_function = std::move(function);
 }
 
-Usage::Usage::~Usage()
+void Usage::Named_Arg::set_default_value(const std::string& argument, const std::unordered_map<std::string, std::string>& defaults, const std::string& otherwise)
 {
-    for (auto arg : m_arguments)
-        delete arg.second;      // args are dynamically created when added
+    set_default_value([argument, defaults, otherwise](const Default_Values& default_values)
+        {
+            auto& values = default_values.get_values(argument);
+            if (!values.empty())
+            {
+                auto itr = defaults.find(values[0]);
+                if (itr != defaults.end())
+                    return (*itr).second;
+            }
+            return otherwise;
+        });
 }
 
-void Usage::Usage::add_Argument(const Argument& argument)
+void Usage::Named_Arg::set_choices(const std::vector<std::string>& choices)
 {
-    auto itr = m_arguments.find(argument.name());
-    assert(itr == m_arguments.end() && "Argument already exists.");
-    Argument* arg;
-    if (argument.named())
-        arg = new Named_Arg{ dynamic_cast<const Named_Arg*>(&argument) };
-    else
-        arg = new Unnamed_Arg{ dynamic_cast<const Unnamed_Arg*>(&argument) };
-    m_arguments[argument.name()] = arg;
-    m_argsorder.push_back(m_arguments[argument.name()]);
-    m_syntax_valid = false;
+    assert((choices.empty() || m_type == Argument_Type::string) && "Choices can only be set for arguments of type string.");
+    m_choices = choices;
 }
 
-void Usage::Usage::remove_Argument(const std::string& name)
+void Usage::Named_Arg::set_range(double min, double max)
 {
-    auto itr = m_arguments.find(name);
-    assert(itr != m_arguments.end() && "Unknown argument name.");
-    auto ord = std::find(m_argsorder.begin(), m_argsorder.end(), (*itr).second);
-    if (ord != m_argsorder.end())
-    {
-        m_requirements.remove_all(*ord);
-        m_conflicts.remove(*ord);
-        m_argsorder.erase(ord);
+    assert(m_type == Argument_Type::string && "A range can only be set for arguments of type string.");
+    assert(min <= max && "The lower bound of a range can't be greater than the upper bound.");
+    m_ranged = true;
+    m_min = min;
+    m_max = max;
+}
+
+void Usage::Named_Arg::set_pattern(const std::string& pattern)
+{
+    assert((pattern.empty() || m_type == Argument_Type::string) && "A pattern can only be set for arguments of type string.");
+    m_pattern = pattern;
+}
+
+Usage::Usage::Usage(const std::string& prog_name, std::pmr::memory_resource* resource)
+    : m_resource{ resource }
+{
+    assert(resource != nullptr && "A memory resource must be set.");
+    program_name = prog_name;
+}
+
+Usage::Usage::~Usage()
+{
+    for (auto arg : m_arguments)
+        m_destroy(arg.second);      // args are dynamically created when added
+}
+
+template<typename T>
+Usage::Argument* Usage::Usage::m_create(const T& argument)
+{
+    std::pmr::polymorphic_allocator<T> allocator{ m_resource };
+    // the memory is given back if the copy fails
+    auto release = [&allocator](T* arg) { allocator.deallocate(arg, 1); };
+    std::unique_ptr<T, decltype(release)> memory{ allocator.allocate(1), release };
+    new (memory.get()) T{ &argument };
+    return memory.release();
+}
+
+void Usage::Usage::m_destroy(Argument* argument) noexcept
+{
+    // the arguments are destroyed through their own type, Argument has no virtual destructor
+    if (argument->named())
+    {
+        auto arg = static_cast<Named_Arg*>(argument);
+        arg->~Named_Arg();
+        std::pmr::polymorphic_allocator<Named_Arg>{ m_resource }.deallocate(arg, 1);
     }
+    else
+    {
+        auto arg = static_cast<Unnamed_Arg*>(argument);
+        arg->~Unnamed_Arg();
+        std::pmr::polymorphic_allocator<Unnamed_Arg>{ m_resource }.deallocate(arg, 1);
+    }
+}
+
+void Usage::Usage::add_Argument(const Argument& argument)
+{
+    auto itr = m_arguments.find(argument.name());
+    assert(itr == m_arguments.end() && "Argument already exists.");
+    Argument* arg;
+    if (argument.named())
+        arg = m_create(*static_cast<const Named_Arg*>(&argument));
+    else
+        arg = m_create(*static_cast<const Unnamed_Arg*>(&argument));
+    m_arguments.emplace(arg->name(), arg);
+    m_argsorder.push_back(arg);
+    m_invalidate();
+}
+
+void Usage::Usage::remove_Argument(const std::string& name)
+{
+    auto itr = m_arguments.find(name);
+    assert(itr != m_arguments.end() && "Unknown argument name.");
+    auto ord = std::find(m_argsorder.begin(), m_argsorder.end(), (*itr).second);
+    if (ord != m_argsorder.end())
+    {
+        m_requirements.remove_all(*ord);
+        m_conflicts.remove(*ord);
+        m_argsorder.erase(ord);
+    }
+    m_aliases.erase(std::remove_if(m_aliases.begin(), m_aliases.end(), [&name](const Alias& alias) { return alias.name == name; }), m_aliases.end());
     Argument* arg = (*itr).second;
     m_arguments.erase(name);
-    delete arg;         // was dynamically created when added
-    m_syntax_valid = false;
+    m_destroy(arg);         // was dynamically created when added
+    m_invalidate();
 }
 
 void Usage::Usage::remove_all() noexcept
 {
     // we must free memory for each dynamically created arg
-    while (!m_arguments.empty())
-        remove_Argument(m_arguments[0]->name());
-    m_syntax_valid = false;
+    m_requirements.clear();
+    m_conflicts.clear();
+    m_aliases.clear();
+    m_argsorder.clear();
+    for (auto arg : m_arguments)
+        m_destroy(arg.second);
+    m_arguments.clear();
+    m_invalidate();
 }
 
 void Usage::Usage::clear() noexcept
@@ -170,22 +1172,41 @@ void Usage::Usage::clear() noexcept
     program_name.clear();
     description.clear();
     usage.clear();
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 Usage::Argument* Usage::Usage::get_Argument(const std::string& name)
 {
     auto arg_itr = m_arguments.find(name);
     if (arg_itr != m_arguments.end())
+    {
+        m_compiled = false;         // the shortcut may be changed through the pointer
+        m_help_valid = false;       // and the help string too
+        m_help_indexed = false;
         return (*arg_itr).second;
+    }
     return NULL;
 }
 
+const Usage::Argument* Usage::Usage::get_Argument(const std::string& name) const
+{
+    auto arg_itr = m_arguments.find(name);
+    return arg_itr != m_arguments.end() ? (*arg_itr).second : nullptr;
+}
+
+std::vector<const Usage::Argument*> Usage::Usage::get_Arguments() const
+{
+    return { m_argsorder.begin(), m_argsorder.end() };
+}
+
 std::vector<Usage::Argument*> Usage::Usage::get_Arguments()
 {
     std::vector<Argument*> result{};
     for (auto arg : m_argsorder)
         result.push_back(arg);
+    m_compiled = false;             // shortcuts may be changed through the pointers
+    m_help_valid = false;           // and help strings too
+    m_help_indexed = false;
     return result;
 }
 
@@ -218,7 +1239,7 @@ void Usage::Usage::add_requirement(const std::string& dependent, const std::stri
     // we must ensure the pair does not already exist
     assert(!m_requirements.exists((*itr1).second, (*itr2).second) && "Requirement is already defined.");
     m_requirements.add((*itr1).second, (*itr2).second);
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 void Usage::Usage::remove_requirement(const std::string& dependent, const std::string& requirement)
@@ -228,7 +1249,7 @@ void Usage::Usage::remove_requirement(const std::string& dependent, const std::s
     assert((itr1 != m_arguments.end() && itr2 != m_arguments.end()) && "Unknown argument name.");
     assert(m_requirements.exists((*itr1).second, (*itr2).second) && "Requirement does not exist.");
     m_requirements.remove((*itr1).second, (*itr2).second);
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 void Usage::Usage::remove_requirements(const std::string& argument)
@@ -237,13 +1258,13 @@ void Usage::Usage::remove_requirements(const std::string& argument)
     assert(itr != m_arguments.end() && "Unknown argument name.");
     assert(m_requirements.has_requirements((*itr).second) && "No requirement exists for this argument.");
     m_requirements.remove_requirement((*itr).second);
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 void Usage::Usage::clear_requirements() noexcept
 {
     m_requirements.clear();
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 bool Usage::Usage::requirement_exists(const std::string& dependent, const std::string& requirement) const
@@ -320,7 +1341,7 @@ void Usage::Usage::set_requirements(const std::unordered_multimap<std::string, s
         add_requirement((*itr).first, (*itr).second);
         ++itr;
     }
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 void Usage::Usage::add_conflict(const std::string& arg1, const std::string& arg2)
@@ -336,7 +1357,7 @@ void Usage::Usage::add_conflict(const std::string& arg1, const std::string& arg2
     // we must ensure the pair does not already exist for the 2 directions (name, conflict) and (conflict, name)
     assert(!(m_conflicts.in_conflict((*itr1).second, (*itr2).second)) && "Conflict already exists.");
     m_conflicts.add((*itr1).second, (*itr2).second);
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 void Usage::Usage::remove_conflict(const std::string& arg1, const std::string& arg2)
@@ -347,7 +1368,7 @@ void Usage::Usage::remove_conflict(const std::string& arg1, const std::string& a
     // conflict definition is searched for the 2 directions (name, conflict) and (conflict, name)
     assert(m_conflicts.in_conflict((*itr1).second, (*itr2).second) && "Conflict does not exist.");
     m_conflicts.remove((*itr1).second, (*itr2).second);
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 void Usage::Usage::remove_conflicts(const std::string& argument)
@@ -357,13 +1378,13 @@ void Usage::Usage::remove_conflicts(const std::string& argument)
     // search must be done for 2 directions (name, x) and (x, name)
     assert(m_conflicts.in_conflict((*itr).second) && "No conflict exists for this argument.");
     m_conflicts.remove((*itr).second);
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 void Usage::Usage::clear_conflicts() noexcept
 {
     m_conflicts.clear();
-    m_syntax_valid = false;
+    m_invalidate();
 }
 
 bool Usage::Usage::in_conflict(const std::string& argument) const
@@ -401,511 +1422,1758 @@ std::vector<std::string> Usage::Usage::get_conflicts(const std::string& argument
     return result;
 }
 
-std::unordered_multimap<std::string, std::string> Usage::Usage::get_conflicts() const
+std::unordered_multimap<std::string, std::string> Usage::Usage::get_conflicts() const
+{
+    auto conflicts = m_conflicts.get();
+    std::unordered_multimap<std::string, std::string> result{};
+    auto itr = conflicts.begin();
+    while (itr != conflicts.end())
+    {
+        result.insert({ (*itr).first->name(), (*itr).second->name() });
+        ++itr;
+    }
+    return result;
+}
+
+void Usage::Usage::set_conflicts(const std::unordered_multimap<std::string, std::string>& conflicts)
+{
+    auto itr = conflicts.begin();
+    while (itr != conflicts.end())
+    {
+        add_conflict((*itr).first, (*itr).second);
+        ++itr;
+    }
+    m_invalidate();
+}
+
+void Usage::Usage::add_alias(const std::string& alias, const std::string& name, bool deprecated)
+{
+    assert(!alias.empty() && "An alias cannot be empty.");
+    auto itr = m_arguments.find(name);
+    assert(itr != m_arguments.end() && "Unknown argument name.");
+    assert((*itr).second->named() && "Aliases can only be set for named arguments.");
+    assert(m_arguments.find(alias) == m_arguments.end() && "Alias is used as an argument name.");
+    assert(std::find_if(m_aliases.begin(), m_aliases.end(), [&alias](const Alias& a) { return a.alias == alias; }) == m_aliases.end() && "Alias already exists.");
+    m_aliases.push_back({ alias, name, "", false, deprecated });
+    m_invalidate();
+}
+
+void Usage::Usage::add_rewrite(const std::string& alias, const std::string& name, const std::string& value, bool deprecated)
+{
+    add_alias(alias, name, deprecated);
+    auto type = static_cast<Named_Arg*>((*m_arguments.find(name)).second)->type();
+    assert(type != Argument_Type::simple && "A simple argument cannot receive a value.");
+    assert((type != Argument_Type::boolean || value == "true" || value == "false") && "The value of a boolean argument must be true or false.");
+    m_aliases.back().value = value;
+    m_aliases.back().rewrite = true;
+}
+
+void Usage::Usage::remove_alias(const std::string& alias)
+{
+    auto itr = std::find_if(m_aliases.begin(), m_aliases.end(), [&alias](const Alias& a) { return a.alias == alias; });
+    assert(itr != m_aliases.end() && "Unknown alias.");
+    m_aliases.erase(itr);
+    m_invalidate();
+}
+
+std::vector<std::string> Usage::Usage::get_aliases(const std::string& name) const
+{
+    assert(m_arguments.find(name) != m_arguments.end() && "Unknown argument name.");
+    std::vector<std::string> result{};
+    for (auto& alias : m_aliases)
+        if (alias.name == name)
+            result.push_back(alias.alias);
+    return result;
+}
+
+std::unordered_map<std::string, size_t> Usage::Usage::get_deprecated_uses() const
+{
+    std::unordered_map<std::string, size_t> result{};
+    for (auto& use : m_deprecated_uses)
+        result.emplace(use.first, use.second);
+    return result;
+}
+
+void Usage::Usage::m_count_deprecated(std::string_view alias)
+{
+    m_deprecated_uses[std::pmr::string{ alias, m_resource }]++;
+}
+
+std::string Usage::Usage::load_from_file(const std::string& fname)
+{
+    static const std::string CANT_READ{ "Unable to read the file '%s'." };
+    static const std::string NO_SYNTAX{ "No syntax found in the file '%s'." };
+    static const std::string MISSING_NAME{ "Missing argument name at line %zu of the file '%s'." };
+    static const std::string FILE_ERROR{ "%s In the file '%s'." };
+
+    auto file = std::fopen(fname.c_str(), "rb");
+    if (file == nullptr)
+        return str_utils::get_message(CANT_READ.c_str(), fname.c_str());
+    std::string data{};
+    std::array<char, 4096> buf;
+    size_t n{ 0 };
+    while ((n = std::fread(buf.data(), 1, buf.size(), file)) > 0)
+        data.append(buf.data(), n);
+    std::fclose(file);
+
+    std::string syntax{};
+    std::unordered_map<std::string, std::string> helpstrings{};
+    std::string* helpstring{ nullptr };
+    size_t line_number{ 0 };
+    size_t start{ 0 };
+    while (start < data.size())
+    {
+        auto end = data.find('\n', start);
+        if (end == std::string::npos)
+            end = data.size();
+        std::string line = data.substr(start, end - start);
+        start = end + 1;
+        line_number++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        auto first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[0] == '#')
+            continue;
+        if (syntax.empty())
+            syntax = line.substr(first);
+        else if (first > 0 && helpstring != nullptr)
+            (*helpstring).append("\n").append(line.substr(first));
+        else
+        {
+            auto colon = line.find(':');
+            if (colon == std::string::npos || colon == 0)
+                return str_utils::get_message(MISSING_NAME.c_str(), line_number, fname.c_str());
+            auto text = line.find_first_not_of(" \t", colon + 1);
+            helpstring = &helpstrings[line.substr(0, line.find_last_not_of(" \t", colon - 1) + 1)];
+            *helpstring = text != std::string::npos ? line.substr(text) : "";
+        }
+    }
+    if (syntax.empty())
+        return str_utils::get_message(NO_SYNTAX.c_str(), fname.c_str());
+    auto ret = compile_syntax(syntax, helpstrings);
+    if (ret != "")
+        return str_utils::get_message(FILE_ERROR.c_str(), ret.c_str(), fname.c_str());
+    program_name = syntax.substr(0, syntax.find_first_of(" \t"));
+    return ret;
+}
+
+void Usage::Usage::save_to_file(const std::string& fname) const
+{}
+
+void Usage::Usage::set_syntax(const std::string& syntax)
+{
+    m_syntax_string = syntax;
+    m_syntax_valid = true;
+    m_help_valid = false;
+}
+
+void Usage::Usage::m_invalidate() noexcept
+{
+    m_syntax_valid = false;
+    m_compiled = false;
+    m_help_valid = false;
+    m_help_indexed = false;
+    m_state = Parse_State{};
+}
+
+std::string_view Usage::Usage::m_intern(std::string_view name)
+{
+    if (!m_folded)
+        return name;
+    auto chars = static_cast<char*>(m_name_arena.allocate(name.size(), 1));
+    std::memcpy(chars, name.data(), name.size());
+    if (m_folded)
+        fold_ascii(chars, name.size());
+    return { chars, name.size() };
+}
+
+void Usage::Usage::m_compile()
+{
+    // the keys of the shortcuts, that are not stored as strings by the arguments
+    static const std::array<char, 256> CHARS = []()
+    {
+        std::array<char, 256> chars{};
+        for (size_t c = 0; c < chars.size(); c++)
+            chars[c] = static_cast<char>(c);
+        return chars;
+    }();
+
+    if (m_compiled && m_folded == case_insensitive)
+        return;
+    m_folded = case_insensitive;
+    assert(m_argsorder.size() < NO_ALIAS && m_aliases.size() < NO_ALIAS && "Too many arguments.");
+    m_names.clear();
+    m_name_arena.release();
+    m_indexes.clear();
+    m_names.reserve(m_argsorder.size() * 2 + m_aliases.size());
+    for (std::uint32_t i = 0; i < m_argsorder.size(); i++)
+    {
+        m_indexes[m_argsorder[i]] = i;
+        if (m_argsorder[i]->named())
+        {
+            [[maybe_unused]] auto added = m_names.emplace(m_intern(m_argsorder[i]->name()), Name_Entry{ i }).second;
+            assert(added && "Names differ only by case.");
+        }
+    }
+    // names have priority over shortcuts
+    for (std::uint32_t i = 0; i < m_argsorder.size(); i++)
+    {
+        if (m_argsorder[i]->named())
+        {
+            auto raw = static_cast<Named_Arg*>(m_argsorder[i])->shortcut_char;
+            auto shortcut = raw;
+            if (m_folded)
+                fold_ascii(&shortcut, 1);
+            if (shortcut == ' ')
+                continue;
+            // the first argument wins in both modes, but two shortcuts that are equal only once folded are ambiguous
+            auto itr = m_names.find(std::string_view{ &shortcut, 1 });
+            assert((itr == m_names.end() || m_argsorder[(*itr).second.index]->name().size() == 1
+                || static_cast<Named_Arg*>(m_argsorder[(*itr).second.index])->shortcut_char == raw) && "Shortcuts differ only by case.");
+            if (itr == m_names.end())
+                m_names.emplace(std::string_view{ &CHARS[(unsigned char)shortcut], 1 }, Name_Entry{ i });
+        }
+    }
+    for (std::uint32_t a = 0; a < m_aliases.size(); a++)
+    {
+        auto alias = m_intern(m_aliases[a].alias);
+        assert(m_names.find(alias) == m_names.end() && "Alias is used as a shortcut.");
+        m_names.emplace(alias, Name_Entry{ (std::uint32_t)m_indexes[(*m_arguments.find(m_aliases[a].name)).second], a });
+    }
+    m_help_search = m_find_named(help_arg) == nullptr;
+    m_validators.assign(m_argsorder.size(), Validator{});
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+    {
+        if (!m_argsorder[i]->named())
+            continue;
+        auto arg = static_cast<Named_Arg*>(m_argsorder[i]);
+        auto choices = arg->choices();
+        m_validators[i].choices.insert(choices.begin(), choices.end());
+        m_validators[i].ranged = arg->ranged();
+        m_validators[i].min = arg->range_min();
+        m_validators[i].max = arg->range_max();
+        auto pattern = arg->pattern();
+        if (!pattern.empty())
+        {
+            std::pmr::string key{ pattern, m_resource };
+            auto itr = m_patterns.find(key);
+            if (itr == m_patterns.end())
+                itr = m_patterns.emplace(std::move(key), std::unique_ptr<Pattern, Pattern_Deleter>{ new Pattern{ std::regex{ pattern, std::regex::ECMAScript | std::regex::optimize } } }).first;
+            m_validators[i].pattern = (*itr).second.get();
+        }
+    }
+    // components of the graph of requirements and conflicts, by union-find
+    std::vector<size_t> parent(m_argsorder.size());
+    for (size_t i = 0; i < parent.size(); i++)
+        parent[i] = i;
+    auto root = [&parent](size_t i)
+    {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    auto join = [&](const Argument* a, const Argument* b)
+    {
+        auto ra = root(m_indexes[a]);
+        auto rb = root(m_indexes[b]);
+        if (ra != rb)
+            parent[std::max(ra, rb)] = std::min(ra, rb);
+    };
+    for (auto& req : m_requirements.get())
+        join(req.first, req.second);
+    for (auto& con : m_conflicts.get())
+        join(con.first, con.second);
+    // a component is numbered by its first argument, the members are sorted by a counting sort
+    m_component.assign(m_argsorder.size(), 0);
+    std::vector<size_t> number(m_argsorder.size(), SIZE_MAX);
+    std::vector<size_t> counts{};
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+    {
+        auto r = root(i);
+        if (number[r] == SIZE_MAX)
+        {
+            number[r] = counts.size();
+            counts.push_back(0);
+        }
+        m_component[i] = number[r];
+        counts[m_component[i]]++;
+    }
+    m_component_offsets.assign(counts.size() + 1, 0);
+    for (size_t c = 0; c < counts.size(); c++)
+        m_component_offsets[c + 1] = m_component_offsets[c] + counts[c];
+    m_members.assign(m_argsorder.size(), 0);
+    std::vector<size_t> next(m_component_offsets.begin(), m_component_offsets.end() - 1);
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+        m_members[next[m_component[i]]++] = i;
+    m_compiled = true;
+}
+
+bool Usage::Usage::m_valid_value(size_t arg_index, const std::string& value) const
+{
+    auto& validator = m_validators[arg_index];
+    if (!validator.choices.empty() && validator.choices.find(value) == validator.choices.end())
+        return false;
+    if (validator.ranged)
+    {
+        // a decimal number whatever the locale, with an optional sign and exponent ; spaces, hexadecimal, infinite and nan values are rejected
+        auto first = value.data();
+        auto last = first + value.size();
+        if (first != last && *first == '+' && last - first > 1 && first[1] != '-')
+            first++;
+        double number{ 0 };
+        auto result = std::from_chars(first, last, number, std::chars_format::general);
+        if (result.ec != std::errc{} || result.ptr != last || !std::isfinite(number) || number < validator.min || number > validator.max)
+            return false;
+    }
+    if (validator.pattern != nullptr)
+    {
+#ifdef USAGE_EXCEPTIONS
+        try
+        {
+            return std::regex_match(value, validator.pattern->regex);
+        }
+        catch (const std::regex_error&)
+        {
+            return false;       // the value is too complex for the regex engine
+        }
+#else
+        return std::regex_match(value, validator.pattern->regex);
+#endif
+    }
+    return true;
+}
+
+void Usage::Usage::m_publish()
+{
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+        m_argsorder[i]->value = m_state.values[i];
+}
+
+void Usage::Usage::m_publish(size_t arg_index)
+{
+    m_argsorder[arg_index]->value = m_state.values[arg_index];
+}
+
+bool Usage::Usage::m_has_default(size_t arg_index) const
+{
+    if (!m_argsorder[arg_index]->named())
+        return false;
+    auto arg = static_cast<Named_Arg*>(m_argsorder[arg_index]);
+    return !arg->default_value().empty() || arg->default_function();
+}
+
+bool Usage::Usage::m_computed_default(size_t arg_index, const Parse_State& state) const
+{
+    return state.defaults[arg_index] && static_cast<Named_Arg*>(m_argsorder[arg_index])->default_function();
+}
+
+std::string Usage::Usage::m_resolve_defaults(Parse_State& state, bool compute) const
+{
+    static const std::string switch_str{ switch_char };
+    static const std::string DEFAULT_CYCLE{ "The default value of the argument '%s' depends on itself - see %s " + switch_str + help_arg + " for help." };
+
+    Default_Values values{ *this, state };
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+    {
+        if (m_computed_default(i, state))
+        {
+            state.values[i].clear();
+            values.m_marks[i] = 0;
+        }
+    }
+    if (!compute)
+        return "";
+    for (size_t i = 0; i < m_argsorder.size() && values.m_cycle.empty(); i++)
+        values.m_resolve(i);
+    if (values.m_cycle.empty())
+        return "";
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+        if (m_computed_default(i, state))
+            state.values[i].clear();
+    state.error = Parse_Error::default_cycle;
+    state.error_argument = values.m_cycle;
+    return str_utils::get_message(DEFAULT_CYCLE.c_str(), values.m_cycle.c_str(), program_name.c_str());
+}
+
+void Usage::Usage::m_update_defaults()
+{
+    if (m_state.message == "")
+        m_state.message = m_resolve_defaults(m_state, true);
+    else
+        m_resolve_defaults(m_state, false);
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+        if (m_computed_default(i, m_state))
+            m_publish(i);
+}
+
+Usage::Default_Values::Default_Values(const Usage& usage, Parse_State& state)
+    : m_usage{ usage }, m_state{ state }, m_marks(usage.m_argsorder.size(), 2)
+{
+}
+
+const std::vector<std::string>& Usage::Default_Values::get_values(const std::string& name) const
+{
+    auto itr = m_usage.m_arguments.find(name);
+    assert(itr != m_usage.m_arguments.end() && "Unknown argument name.");
+    auto arg_index = m_usage.m_index((*itr).second);
+    m_resolve(arg_index);
+    return m_state.values[arg_index];
+}
+
+void Usage::Default_Values::m_resolve(size_t arg_index) const
+{
+    if (m_marks[arg_index] == 2)
+        return;
+    if (m_marks[arg_index] == 1)
+    {
+        // the default value reads itself, directly or through other computed default values
+        if (m_cycle.empty())
+            m_cycle = m_usage.m_argsorder[arg_index]->name();
+        return;
+    }
+    m_marks[arg_index] = 1;
+    auto value = static_cast<Named_Arg*>(m_usage.m_argsorder[arg_index])->default_function()(*this);
+    if (m_cycle.empty())
+        m_state.values[arg_index] = { std::move(value) };
+    m_marks[arg_index] = 2;
+}
+
+size_t Usage::Usage::m_index(const Argument* argument) const
+{
+    auto itr = m_indexes.find(argument);
+    assert(itr != m_indexes.end() && "Unknown argument.");
+    return (*itr).second;
+}
+
+const Usage::Usage::Name_Entry* Usage::Usage::m_find_named(std::string_view name) const
+{
+    // names are short, they are folded on the stack
+    std::array<char, 64> buffer;
+    std::string long_name{};
+    if (m_folded)
+    {
+        char* folded{ buffer.data() };
+        if (name.size() > buffer.size())
+        {
+            long_name.assign(name);
+            folded = &long_name[0];
+        }
+        else
+            std::memcpy(folded, name.data(), name.size());
+        fold_ascii(folded, name.size());
+        name = std::string_view{ folded, name.size() };
+    }
+    auto itr = m_names.find(name);
+    if (itr == m_names.end())
+        return nullptr;
+    return &(*itr).second;
+}
+
+Usage::Usage::Token Usage::Usage::m_tokenize(std::string_view arg) const
+{
+    Token token{};
+    std::string_view p{ arg };
+    bool named{ p[0] == switch_char };
+    if (named)
+        p.remove_prefix(1);
+    if (p.empty())
+        return token;
+    // the help argument is matched as the names are
+    auto is_help = [this](const char* key)
+    {
+        for (size_t i = 0; i < help_arg.size(); i++)
+        {
+            char c{ key[i] };
+            if (m_folded)
+                fold_ascii(&c, 1);
+            if (c != help_arg[i])
+                return false;
+        }
+        return true;
+    };
+    if (p.size() == help_arg.size() && is_help(p.data()))
+    {
+        // Help requested
+        token.kind = Token::Kind::help;
+        return token;
+    }
+    if (named && m_help_search && p.size() > help_arg.size() && p[help_arg.size()] == ':' && is_help(p.data()))
+    {
+        // Help searched
+        token.kind = Token::Kind::help;
+        token.value = p.substr(help_arg.size() + 1);
+        return token;
+    }
+    auto quote = p.find('\"');
+    bool quoted{ quote != std::string_view::npos };
+    std::string value{};
+    if (!named)
+    {
+        token.kind = Token::Kind::unnamed;
+        token.value = quoted ? unquote(p.data(), p.size()) : std::string{ p };
+        return token;
+    }
+    if (quoted)
+    {
+        value = unquote(p.data() + quote, p.size() - quote);
+        p = p.substr(0, quote);
+    }
+    if (p.empty())
+        return token;
+    Argument_Type type_p{ Argument_Type::simple };
+    auto colon = p.find(':');
+    if (colon != std::string_view::npos)
+    {
+        if (colon < p.size() - 1)
+            value.insert(0, p.substr(colon + 1));
+        type_p = Argument_Type::string;
+        p = p.substr(0, colon);
+    }
+    else
+    {
+        auto sgn = p.back();
+        if (sgn == '+' || sgn == '-')
+        {
+            type_p = Argument_Type::boolean;
+            p.remove_suffix(1);
+            if (quoted)
+                return token;
+            value = "false";
+            if (sgn == '+')
+                value = "true";
+        }
+        else
+        {
+            // simple argument
+            if (quoted)
+                return token;
+            value = "true";
+        }
+    }
+    if (p.empty())
+        return token;
+    token.kind = Token::Kind::named;
+    token.name = p;
+    token.type = type_p;
+    token.value = std::move(value);
+    return token;
+}
+
+bool Usage::Usage::m_add_unnamed(size_t arg_index, const std::string& value, Parse_State& state, bool parallel) const
+{
+    auto arg = static_cast<Unnamed_Arg*>(m_argsorder[arg_index]);
+    auto& values = state.values[arg_index];
+    size_t limit{ limits.max_values != 0 ? limits.max_values : SIZE_MAX };
+    if (arg->many && arg->glob && has_wildcard(value))
+    {
+        auto paths = glob_expand(value, limit - values.size(), parallel);
+        if (!paths.empty())
+        {
+            if (paths.size() > limit - values.size())
+                return false;
+            values.insert(values.end(), std::make_move_iterator(paths.begin()), std::make_move_iterator(paths.end()));
+            return true;
+        }
+    }
+    if (values.size() == limit)
+        return false;
+    values.push_back(value);
+    return true;
+}
+
+bool Usage::Usage::m_check_unnamed(const std::string& value, Parse_State& state, bool& many, size_t& unnamed, bool parallel) const
+{
+    bool found{ false };
+
+    if (many)
+    {
+        if (!m_add_unnamed(unnamed, value, state, parallel))
+        {
+            state.error = Parse_Error::limit_exceeded;
+            return false;
+        }
+        found = true;
+    }
+    else
+    {
+        for (size_t i = 0; i < m_argsorder.size(); i++)
+        {
+            if (!m_argsorder[i]->named() && !state.set_args[i])
+            {
+                unnamed = i;
+                if (!m_add_unnamed(i, value, state, parallel))
+                {
+                    state.error = Parse_Error::limit_exceeded;
+                    return false;
+                }
+                state.set_args[i] = true;
+                many = static_cast<Unnamed_Arg*>(m_argsorder[i])->many;
+                found = true;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+std::string Usage::Usage::m_check_type(const std::string& p, Argument_Type type_p, const std::string& value, Parse_State& state, size_t& arg_index, Parse_Error& error, bool replace) const
+{
+    static const std::string switch_str{ switch_char };
+    static const std::string TYPE_MISMATCH{ "Argument '%s' passed as '%s' while expected type is '%s' - see %s " + switch_str + help_arg + " for help." };
+    static const std::string UNKNOW_ARGUMENT{ "Unknown argument '" + switch_str + "%s' - see %s " + switch_str + help_arg + " for help." };
+
+    auto entry = m_find_named(p);
+    if (entry == nullptr || (state.set_args[entry->index] && !state.defaults[entry->index] && !replace))
+    {
+        error = Parse_Error::unknown_argument;
+        return str_utils::get_message(UNKNOW_ARGUMENT.c_str(), p.c_str(), program_name.c_str());
+    }
+    arg_index = entry->index;
+    Argument_Type type_a = static_cast<Named_Arg*>(m_argsorder[arg_index])->type();
+    const Alias* alias{ entry->alias != NO_ALIAS ? &m_aliases[entry->alias] : nullptr };
+    if (alias != nullptr && alias->rewrite)
+    {
+        // a rewrite is passed as a simple argument
+        if (type_p != Argument_Type::simple)
+        {
+            error = Parse_Error::type_mismatch;
+            return str_utils::get_message(TYPE_MISMATCH.c_str(), alias->alias.c_str(),
+                AType_toStr(type_p).c_str(), AType_toStr(Argument_Type::simple).c_str(), program_name.c_str());
+        }
+    }
+    else if (type_p != type_a)
+    {
+        error = Parse_Error::type_mismatch;
+        return str_utils::get_message(TYPE_MISMATCH.c_str(), m_argsorder[arg_index]->name().c_str(),
+            AType_toStr(type_p).c_str(), AType_toStr(type_a).c_str(), program_name.c_str());
+    }
+    state.values[arg_index].clear();
+    state.values[arg_index].push_back(alias != nullptr && alias->rewrite ? alias->value : value);
+    if (alias != nullptr && alias->deprecated)
+        state.deprecated.push_back(alias->alias);
+    state.set_args[arg_index] = true;
+    state.defaults[arg_index] = false;
+    // All is fine
+    return "";
+}
+
+Usage::Usage::Token Usage::Usage::m_limit(const char* name, size_t value, size_t position)
+{
+    Token token{};
+    token.kind = Token::Kind::limit;
+    token.name = name;
+    token.value = std::to_string(value);
+    token.position = position;
+    return token;
+}
+
+bool Usage::Usage::m_check_limits(const char* arg, size_t position, size_t& bytes, Token& token) const
+{
+    // the length is never read beyond the limits
+    size_t bound{ limits.max_value_length != 0 ? limits.max_value_length + 1 : SIZE_MAX };
+    if (limits.max_bytes != 0)
+        bound = std::min(bound, limits.max_bytes - bytes + 1);
+    return m_check_limits(strnlen(arg, bound), position, bytes, token);
+}
+
+bool Usage::Usage::m_check_limits(size_t length, size_t position, size_t& bytes, Token& token) const
+{
+    if (limits.max_value_length != 0 && length > limits.max_value_length)
+    {
+        token = m_limit("bytes per argument", limits.max_value_length, position);
+        return true;
+    }
+    bytes += length;
+    if (limits.max_bytes != 0 && bytes > limits.max_bytes)
+    {
+        token = m_limit("bytes", limits.max_bytes, position);
+        return true;
+    }
+    return false;
+}
+
+std::vector<Usage::Usage::Token> Usage::Usage::m_tokenize(int argc, char* argv[]) const
+{
+    // the limits are checked before any value is copied
+    if (limits.max_tokens != 0 && (size_t)argc - 1 > limits.max_tokens)
+        return { m_limit("arguments", limits.max_tokens, limits.max_tokens + 1) };
+    size_t bytes{ 0 };
+    for (size_t i = 1; i < (size_t)argc; i++)
+    {
+        Token token{};
+        if (m_check_limits(argv[i], i, bytes, token))
+            return { token };
+    }
+    std::vector<Token> tokens{};
+    tokens.reserve(argc);
+    for (size_t i = 1; i < (size_t)argc; i++)
+    {
+        std::string_view p{ argv[i] };
+        if (p.empty())
+            continue;
+        tokens.push_back(m_tokenize(p));
+        tokens.back().position = i;
+        tokens.back().length = p.size();
+        if (tokens.back().kind == Token::Kind::invalid)
+            tokens.back().value = p;
+    }
+    return tokens;
+}
+
+std::string Usage::Usage::m_parse_token(const Token& token, Parse_State& state, bool& many, size_t& unnamed, bool parallel) const
+{
+    static const std::string switch_str{ switch_char };
+    static const std::string SYNTAX_ERROR{ "Error found in command line argument number %i: '%s' - see %s " + switch_str + help_arg + " for help." };
+    static const std::string LIMIT_EXCEEDED{ "Command line exceeds the limit of %s %s at argument number %zu - see %s " + switch_str + help_arg + " for help." };
+    static const std::string TOO_MANY_VALUES{ "Argument '%s' exceeds the limit of %zu values - see %s " + switch_str + help_arg + " for help." };
+
+    switch (token.kind)
+    {
+    case Token::Kind::help:
+        state.error = Parse_Error::help;
+        state.error_argument = token.value;
+        return "?";
+    case Token::Kind::invalid:
+        state.error = Parse_Error::syntax;
+        state.error_argument = token.value;
+        return str_utils::get_message(SYNTAX_ERROR.c_str(), token.position, token.value.c_str(), program_name.c_str());
+    case Token::Kind::limit:
+        state.error = Parse_Error::limit_exceeded;
+        return str_utils::get_message(LIMIT_EXCEEDED.c_str(), token.value.c_str(), token.name.c_str(), token.position, program_name.c_str());
+    case Token::Kind::unnamed:
+        if (!m_check_unnamed(token.value, state, many, unnamed, parallel))
+        {
+            if (state.error == Parse_Error::limit_exceeded)
+            {
+                state.error_argument = m_argsorder[unnamed]->name();
+                return str_utils::get_message(TOO_MANY_VALUES.c_str(), m_argsorder[unnamed]->name().c_str(), limits.max_values, program_name.c_str());
+            }
+            state.error = Parse_Error::syntax;
+            state.error_argument = token.value;
+            return str_utils::get_message(SYNTAX_ERROR.c_str(), token.position, token.value.c_str(), program_name.c_str());
+        }
+        break;
+    case Token::Kind::named:
+    {
+        many = false;
+        size_t arg_index;
+        auto ret = m_check_type(token.name, token.type, token.value, state, arg_index, state.error);
+        if (ret != "")
+        {
+            state.error_argument = state.error == Parse_Error::unknown_argument ? token.name : m_argsorder[arg_index]->name();
+            return ret;
+        }
+        break;
+    }
+    }
+    return "";
+}
+
+std::string Usage::Usage::m_parser(const std::vector<Token>& tokens, Parse_State& state, bool parallel) const
+{
+    bool many{ false };
+    size_t unnamed{ 0 };
+    for (auto& token : tokens)
+    {
+        state.bytes += token.length;
+        auto ret = m_parse_token(token, state, many, unnamed, parallel);
+        if (ret != "")
+            return ret;
+    }
+    // All is fine and values are affected to arguments
+    return "";
+}
+
+bool Usage::Usage::m_default_applies(size_t arg_index, const Parse_State& state) const
+{
+    if (!m_has_default(arg_index))
+        return false;
+    // default value must be applied only if required args are effectively used
+    auto reqs = m_requirements.requirements(m_argsorder[arg_index]);
+    if (reqs.empty())
+        return true;        // always apply default value for non-dependent args
+    for (auto req : reqs)
+    {
+        auto j = m_index(req);
+        // default values are applied in the order of the arguments
+        if (state.set_args[j] && (!state.defaults[j] || j < arg_index))
+            return true;
+    }
+    return false;
+}
+
+void Usage::Usage::m_check_requirements(size_t arg_index, Parse_State& state) const
+{
+    if (!state.set_args[arg_index] && m_default_applies(arg_index, state))
+    {
+        // computed default values are left empty until all the rules are met
+        if (!static_cast<Named_Arg*>(m_argsorder[arg_index])->default_function())
+            state.values[arg_index].push_back(static_cast<Named_Arg*>(m_argsorder[arg_index])->default_value());
+        state.set_args[arg_index] = true;
+        state.defaults[arg_index] = true;
+    }
+}
+
+bool Usage::Usage::m_missing(size_t arg_index, const Parse_State& state) const
+{
+    if (state.set_args[arg_index] || !m_argsorder[arg_index]->required())
+        return false;
+    // inspect args in direct conflict with the current one
+    auto cons = m_conflicts.conflicts(m_argsorder[arg_index]);
+    for (auto con : cons)
+        if (state.set_args[m_index(con)])
+            return false;
+    return true;
+}
+
+size_t Usage::Usage::m_check_argument(Parse_State& state) const
+{
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+    {
+        if (m_missing(i, state))
+            return i;
+        m_check_requirements(i, state);
+    }
+    // All is fine
+    return -1;
+}
+
+std::string Usage::Usage::m_check_pair(size_t i, size_t j, Parse_State& state) const
+{
+    static const std::string switch_str{ switch_char };
+    static const std::string REQUIRED_ARGUMENT{ "Missing required argument '%s' - see %s " + switch_str + help_arg + " for help." };
+    static const std::string CONFLICT{ "Arguments '%s' and '%s' can't be used together - see %s " + switch_str + help_arg + " for help." };
+
+    switch (m_pair_error(i, j, state))
+    {
+    case Parse_Error::conflict:
+        state.error = Parse_Error::conflict;
+        state.error_argument = m_argsorder[i]->name();
+        return str_utils::get_message(CONFLICT.c_str(), m_argsorder[i]->name().c_str(), m_argsorder[j]->name().c_str(), program_name.c_str());
+    case Parse_Error::missing_argument:
+        state.error = Parse_Error::missing_argument;
+        state.error_argument = m_argsorder[j]->name();
+        return str_utils::get_message(REQUIRED_ARGUMENT.c_str(), m_argsorder[j]->name().c_str(), program_name.c_str());
+    default:
+        return "";
+    }
+}
+
+Usage::Parse_Error Usage::Usage::m_pair_error(size_t i, size_t j, const Parse_State& state) const
+{
+    if (i == j || !state.set_args[i] || m_component[i] != m_component[j])
+        return Parse_Error::none;
+    if (state.set_args[j] && m_conflicts.in_conflict(m_argsorder[i], m_argsorder[j]))
+        return Parse_Error::conflict;
+    if (!state.set_args[j] && m_requirements.exists(m_argsorder[i], m_argsorder[j], true))
+        return Parse_Error::missing_argument;
+    return Parse_Error::none;
+}
+
+std::pair<size_t, size_t> Usage::Usage::m_first_broken(size_t component, const Parse_State& state) const
+{
+    auto first = m_members.begin() + m_component_offsets[component];
+    auto last = m_members.begin() + m_component_offsets[component + 1];
+    for (auto i = first; i != last; ++i)
+    {
+        if (!state.set_args[*i])
+            continue;
+        for (auto j = first; j != last; ++j)
+            if (m_pair_error(*i, *j, state) != Parse_Error::none)
+                return { *i, *j };
+    }
+    return { m_argsorder.size(), m_argsorder.size() };
+}
+
+std::string Usage::Usage::m_check_dependencies(Parse_State& state, bool parallel) const
+{
+    static const std::string switch_str{ switch_char };
+    static const std::string REQUIRED_ARGUMENT{ "Missing required argument '%s' - see %s " + switch_str + help_arg + " for help." };
+
+    auto ret = m_check_argument(state);
+    if (ret != -1)
+    {
+        state.error = Parse_Error::missing_argument;
+        state.error_argument = m_argsorder[ret]->name();
+        return str_utils::get_message(REQUIRED_ARGUMENT.c_str(), m_argsorder[ret]->name().c_str(), program_name.c_str());
+    }
+    auto components = m_component_offsets.size() - 1;
+    if (parallel && m_argsorder.size() >= PARALLEL_MIN_ARGUMENTS && components > 1)
+    {
+        // the components are shared by a pool of threads, the first broken pair in the order of the arguments is reported
+        auto threads = std::min<size_t>(components, std::max(1u, std::thread::hardware_concurrency()));
+        std::atomic<size_t> next{ 0 };
+        std::vector<std::pair<size_t, size_t>> broken(threads, { m_argsorder.size(), m_argsorder.size() });
+        auto walk = [&](size_t t)
+        {
+            for (auto c = next++; c < components; c = next++)
+                broken[t] = std::min(broken[t], m_first_broken(c, state));
+        };
+        std::vector<std::thread> pool{};
+        for (size_t t = 1; t < threads; t++)
+            pool.emplace_back(walk, t);
+        walk(0);
+        for (auto& thread : pool)
+            thread.join();
+        auto first = *std::min_element(broken.begin(), broken.end());
+        if (first.first < m_argsorder.size())
+            return m_check_pair(first.first, first.second, state);
+        return "";
+    }
+    for (size_t i = 0; i < m_argsorder.size(); i++)
+    {
+        if (state.set_args[i])
+        {
+            // rules are only checked within the component of the argument
+            auto c = m_component[i];
+            for (auto k = m_component_offsets[c]; k < m_component_offsets[c + 1]; k++)
+            {
+                auto msg = m_check_pair(i, m_members[k], state);
+                if (msg != "")
+                    return msg;
+            }
+        }
+    }
+    // All is fine and values are affected to arguments
+    return "";
+}
+
+std::string Usage::Usage::m_check_values(Parse_State& state, const std::vector<size_t>* affected) const
+{
+    static const std::string switch_str{ switch_char };
+    static const std::string INVALID_VALUE{ "Invalid value '%s' for argument '%s' - see %s " + switch_str + help_arg + " for help." };
+    static const std::string INVALID_UTF8{ "Invalid UTF-8 sequence at byte %zu of a value of argument '%s' - see %s " + switch_str + help_arg + " for help." };
+
+    auto count = affected != nullptr ? affected->size() : m_argsorder.size();
+    for (size_t k = 0; k < count; k++)
+    {
+        auto i = affected != nullptr ? (*affected)[k] : k;
+        if (state.defaults[i])
+            continue;           // default values are not checked
+        for (auto& value : state.values[i])
+        {
+            if (m_argsorder[i]->check_utf8)
+            {
+                auto offset = utf8_error(value.data(), value.size());
+                if (offset != value.size())
+                {
+                    state.error = Parse_Error::invalid_utf8;
+                    state.error_argument = m_argsorder[i]->name();
+                    return str_utils::get_message(INVALID_UTF8.c_str(), offset, m_argsorder[i]->name().c_str(), program_name.c_str());
+                }
+            }
+            if (!m_valid_value(i, value))
+            {
+                state.error = Parse_Error::invalid_value;
+                state.error_argument = m_argsorder[i]->name();
+                return str_utils::get_message(INVALID_VALUE.c_str(), value.c_str(), m_argsorder[i]->name().c_str(), program_name.c_str());
+            }
+        }
+    }
+    return "";
+}
+
+std::string Usage::Usage::m_check_paths(Parse_State& state, const std::vector<size_t>* affected, bool parallel) const
+{
+    static const std::string switch_str{ switch_char };
+    static const std::string INVALID_PATHS{ "Invalid path(s) %s - see %s " + switch_str + help_arg + " for help." };
+    static const size_t PATHS_PER_THREAD{ 256 };
+
+    std::vector<std::pair<size_t, const std::string*>> paths{};
+    auto count = affected != nullptr ? affected->size() : m_argsorder.size();
+    for (size_t k = 0; k < count; k++)
+    {
+        auto i = affected != nullptr ? (*affected)[k] : k;
+        if (m_argsorder[i]->path_check != Path_Check::none)
+            for (auto& value : state.values[i])
+                paths.push_back({ i, &value });
+    }
+    if (paths.empty())
+        return "";
+    // all the paths are checked at once, by several threads for long lists unless the caller already runs in parallel
+    std::vector<const char*> reasons(paths.size(), nullptr);
+    auto check = [&](size_t first, size_t last)
+    {
+        for (size_t k = first; k < last; k++)
+            reasons[k] = path_error(*paths[k].second, m_argsorder[paths[k].first]->path_check);
+    };
+    size_t threads = parallel ? std::min<size_t>(std::thread::hardware_concurrency(), paths.size() / PATHS_PER_THREAD) : 1;
+    if (threads > 1)
+    {
+        std::vector<std::thread> pool{};
+        auto chunk = (paths.size() + threads - 1) / threads;
+        for (size_t t = 0; t < threads; t++)
+            pool.emplace_back(check, t * chunk, std::min(paths.size(), (t + 1) * chunk));
+        for (auto& thread : pool)
+            thread.join();
+    }
+    else
+        check(0, paths.size());
+    std::string list{};
+    for (size_t k = 0; k < paths.size(); k++)
+    {
+        if (reasons[k] == nullptr)
+            continue;
+        if (list.empty())
+        {
+            state.error = Parse_Error::invalid_path;
+            state.error_argument = m_argsorder[paths[k].first]->name();
+        }
+        else
+            list += ", ";
+        list += "'" + *paths[k].second + "' for argument '" + m_argsorder[paths[k].first]->name() + "' (" + reasons[k] + ")";
+    }
+    if (list.empty())
+        return "";
+    return str_utils::get_message(INVALID_PATHS.c_str(), list.c_str(), program_name.c_str());
+}
+
+std::string Usage::Usage::m_check_all(Parse_State& state, bool parallel) const
+{
+    auto ret = m_check_values(state);
+    if (ret == "")
+        ret = m_check_dependencies(state, parallel);
+    if (ret == "")
+        ret = m_check_paths(state, nullptr, parallel);
+    if (ret == "")
+        ret = m_resolve_defaults(state, true);
+    return ret;
+}
+
+std::string Usage::Usage::m_set_parameters(const std::vector<Token>& tokens)
+{
+    m_compile();
+    m_state = Parse_State{};
+    m_state.values.resize(m_argsorder.size());
+    m_state.set_args.assign(m_argsorder.size(), false);
+    m_state.defaults.assign(m_argsorder.size(), false);
+    auto ret = m_parser(tokens, m_state);
+    if (ret == "")
+    {
+        m_state.parsed = true;
+        ret = m_check_all(m_state);
+    }
+    m_state.message = ret;
+    m_publish();
+    for (auto& alias : m_state.deprecated)
+        m_count_deprecated(alias);
+    return ret;
+}
+
+std::string Usage::Usage::set_parameters(int argc, char* argv[])
 {
-    auto conflicts = m_conflicts.get();
-    std::unordered_multimap<std::string, std::string> result{};
-    auto itr = conflicts.begin();
-    while (itr != conflicts.end())
+    if (argc == 0)
     {
-        result.insert({ (*itr).first->name(), (*itr).second->name() });
-        ++itr;
+        m_state = Parse_State{};
+        m_state.error = Parse_Error::no_argument;
+        return "No argument to evaluate.";
     }
-    return result;
+    m_compile();
+    return m_set_parameters(m_tokenize(argc, argv));
 }
 
-void Usage::Usage::set_conflicts(const std::unordered_multimap<std::string, std::string>& conflicts)
+std::string Usage::Usage::set_parameters(const char* buffer, size_t size)
 {
-    auto itr = conflicts.begin();
-    while (itr != conflicts.end())
+    if (size == 0)
     {
-        add_conflict((*itr).first, (*itr).second);
-        ++itr;
+        m_state = Parse_State{};
+        m_state.error = Parse_Error::no_argument;
+        return "No argument to evaluate.";
     }
-    m_syntax_valid = false;
+    m_compile();
+    return m_set_parameters(m_tokenize(buffer, size));
 }
 
-void Usage::Usage::load_from_file(const std::string& fname)
+size_t Usage::Usage::set_parameters(const std::vector<Usage*>& candidates, int argc, char* argv[])
 {
-    m_syntax_valid = true;
+    if (candidates.empty() || argc == 0)
+        return candidates.size();
+    // switch char and help argument are the same for all instances, the other settings of the split are compared
+    std::vector<std::pair<const Usage*, std::vector<Token>>> splits{};
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        candidates[i]->m_compile();
+        auto split = std::find_if(splits.begin(), splits.end(),
+            [&candidates, i](const std::pair<const Usage*, std::vector<Token>>& s) { return candidates[i]->m_same_tokenizer(*s.first); });
+        if (split == splits.end())
+        {
+            splits.emplace_back(candidates[i], candidates[i]->m_tokenize(argc, argv));
+            split = splits.end() - 1;
+        }
+        auto ret = candidates[i]->m_set_parameters((*split).second);
+        if (ret == "" || ret == "?")
+            return i;
+    }
+    return candidates.size();
 }
 
-void Usage::Usage::save_to_file(const std::string& fname) const
-{}
-
-void Usage::Usage::set_syntax(const std::string& syntax)
+bool Usage::Usage::m_same_tokenizer(const Usage& other) const noexcept
 {
-    m_syntax_string = syntax;
-    m_syntax_valid = true;
+    return limits.max_tokens == other.limits.max_tokens && limits.max_bytes == other.limits.max_bytes
+        && limits.max_value_length == other.limits.max_value_length && m_folded == other.m_folded && m_help_search == other.m_help_search;
 }
 
-bool Usage::Usage::m_check_unnamed(const std::string& value, std::vector<bool>& set_args, bool& many, size_t& unnamed)
+Usage::Parser::Parser(Usage& usage)
+    : m_usage{ &usage }
 {
-    bool found{ false };
+    usage.m_compile();
+    m_state.values.resize(usage.m_argsorder.size());
+    m_state.set_args.assign(usage.m_argsorder.size(), false);
+    m_state.defaults.assign(usage.m_argsorder.size(), false);
+}
 
-    if (many)
-        m_argsorder[unnamed]->value.push_back(value);
-    else
+bool Usage::Parser::push(const std::string& arg)
+{
+    if (m_stopped)
+        return false;
+    m_position++;
+    auto& limits = m_usage->limits;
+    Usage::Token token{};
+    if (limits.max_tokens != 0 && m_position > limits.max_tokens)
+        token = Usage::m_limit("arguments", limits.max_tokens, m_position);
+    else if (!m_usage->m_check_limits(arg.size(), m_position, m_bytes, token))
     {
-        for (size_t i = 0; i < m_argsorder.size(); i++)
-        {
-            if (!m_argsorder[i]->named() && !set_args[i])
-            {
-                m_argsorder[i]->value.push_back(value);
-                set_args[i] = true;
-                many = dynamic_cast<Unnamed_Arg*>(m_argsorder[i])->many;
-                unnamed = i;
-                found = true;
-                break;
-            }
-        }
+        if (arg.empty())
+            return true;
+        token = m_usage->m_tokenize(arg);
+        token.position = m_position;
+        if (token.kind == Usage::Token::Kind::invalid)
+            token.value = arg;
     }
-    return found;
+    m_state.bytes = m_bytes;
+    m_state.message = m_usage->m_parse_token(token, m_state, m_many, m_unnamed);
+    m_stopped = m_state.message != "";
+    return !m_stopped;
 }
 
-std::string Usage::Usage::m_check_type(const std::string& p, Argument_Type type_p, const std::string& value, std::vector<bool>& set_args)
+std::string Usage::Parser::finish()
 {
-    static const std::string switch_str{ switch_char };
-    static const std::string TYPE_MISMATCH{ "Argument '%s' passed as '%s' while expected type is '%s' - see %s " + switch_str + help_arg + " for help." };
-    static const std::string UNKNOW_ARGUMENT{ "Unknown argument '" + switch_str + "%s' - see %s " + switch_str + help_arg + " for help." };
-
-    bool found{ false };
-    for (size_t i = 0; i < m_argsorder.size(); i++)
+    if (m_finished)
+        return m_state.message;
+    m_finished = true;
+    if (!m_stopped)
     {
-        std::string name2{};
-        if (m_argsorder[i]->named() && !set_args[i])
-        {
-            name2 = dynamic_cast<Named_Arg*>(m_argsorder[i])->shortcut_char;
-            if (p == m_argsorder[i]->name() || p == name2)
-            {
-                Argument_Type type_a = dynamic_cast<Named_Arg*>(m_argsorder[i])->type();
-                if (type_p != type_a)
-                    return str_utils::get_message(TYPE_MISMATCH.c_str(), m_argsorder[i]->name().c_str(),
-                        AType_toStr(type_p).c_str(), AType_toStr(type_a).c_str(), program_name.c_str());
-                m_argsorder[i]->value.push_back(value);
-                set_args[i] = true;
-                found = true;
-                break;
-            }
-        }
+        m_stopped = true;
+        m_state.parsed = true;
+        m_state.message = m_usage->m_check_all(m_state);
     }
-    if (!found)
-        return str_utils::get_message(UNKNOW_ARGUMENT.c_str(), p.c_str(), program_name.c_str());
-    // All is fine
-    return "";
+    for (auto& alias : m_state.deprecated)
+        m_usage->m_count_deprecated(alias);
+    return m_state.message;
 }
 
-
-std::string Usage::Usage::m_parser(int argc, char* argv[], std::vector<bool>& set_args)
+std::vector<Usage::Usage::Token> Usage::Usage::m_tokenize(const std::vector<std::string>& args) const
 {
-    static const std::string switch_str{ switch_char };
-    static const std::string SYNTAX_ERROR{ "Error found in command line argument number %i: '%s' - see %s " + switch_str + help_arg + " for help." };
-
-    bool many{ false };
-    size_t unnamed{ 0 };
-    for (size_t i = 1; i < (size_t)argc; i++)
+    if (limits.max_tokens != 0 && args.size() > limits.max_tokens)
+        return { m_limit("arguments", limits.max_tokens, limits.max_tokens + 1) };
+    size_t bytes{ 0 };
+    for (size_t i = 0; i < args.size(); i++)
     {
-        std::string p = argv[i];
-        if (p.empty())
+        Token token{};
+        if (m_check_limits(args[i].size(), i + 1, bytes, token))
+            return { token };
+    }
+    std::vector<Token> tokens{};
+    tokens.reserve(args.size());
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        if (args[i].empty())
             continue;
-        bool named{ p[0] == switch_char };
-        if (named)
-            p.erase(0, 1);
-        if (p.empty())
-            return str_utils::get_message(SYNTAX_ERROR.c_str(), i, argv[i], program_name.c_str(), switch_char, help_arg);
-        if (p == help_arg)
-            // Help requested
-            return "?";
-        auto quote = p.find('\"');
-        bool quoted{ quote != std::string::npos };
-        std::string value{};
-        if (!named)
-        {
-            value = p;
-            if (quoted)
-            {
-                // TODO format value inside quotes
-            }
-            if (!m_check_unnamed(value, set_args, many, unnamed))
-                return str_utils::get_message(SYNTAX_ERROR.c_str(), i, argv[i], program_name.c_str());
+        tokens.push_back(m_tokenize(args[i]));
+        tokens.back().position = i + 1;
+        tokens.back().length = args[i].size();
+        if (tokens.back().kind == Token::Kind::invalid)
+            tokens.back().value = args[i];
+    }
+    return tokens;
+}
+
+std::vector<Usage::Usage::Token> Usage::Usage::m_tokenize(const char* buffer, size_t size) const
+{
+    // the arguments are views of the buffer, the program name is skipped
+    std::vector<std::string_view> args{};
+    auto end = buffer + size;
+    auto p = static_cast<const char*>(memchr(buffer, '\0', size));
+    while (p != nullptr && p + 1 < end)
+    {
+        auto next = static_cast<const char*>(memchr(p + 1, '\0', end - p - 1));
+        args.emplace_back(p + 1, (next != nullptr ? next : end) - p - 1);
+        p = next;
+    }
+    if (limits.max_tokens != 0 && args.size() > limits.max_tokens)
+        return { m_limit("arguments", limits.max_tokens, limits.max_tokens + 1) };
+    size_t bytes{ 0 };
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        Token token{};
+        if (m_check_limits(args[i].size(), i + 1, bytes, token))
+            return { token };
+    }
+    std::vector<Token> tokens{};
+    tokens.reserve(args.size());
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        if (args[i].empty())
             continue;
-        }
-        many = false;
-        if (quoted)
-        {
-            value = p.substr(quote + 1, p.length() - quote - 1);
-            p.erase(quote, p.length() - 1);
-            // TODO format value inside quotes
-        }
-        if (p.empty())
-            return str_utils::get_message(SYNTAX_ERROR.c_str(), i, argv[i], program_name.c_str());
-        Argument_Type type_p{ Argument_Type::simple };
-        auto colon = p.find(':');
-        if (colon != std::string::npos)
-        {
-            if (colon < p.size() - 1)
-                value = p.substr(colon + 1, p.size() - colon) + value;
-            type_p = Argument_Type::string;
-            p.erase(colon, p.length() - colon);
-        }
-        else
-        {
-            auto sgn = p[p.length() - 1];
-            if (sgn == '+' || sgn == '-')
-            {
-                type_p = Argument_Type::boolean;
-                p.erase(p.length() - 1);
-                if (!value.empty())
-                    return str_utils::get_message(SYNTAX_ERROR.c_str(), i, argv[i], program_name.c_str());
-                value = "false";
-                if (sgn == '+')
-                    value = "true";
-            }
-            else
-            {
-                // simple argument
-                if (!value.empty())
-                    return str_utils::get_message(SYNTAX_ERROR.c_str(), i, argv[i], program_name.c_str());
-                value = "true";
-            }
-        }
-        if (p.empty())
-            return str_utils::get_message(SYNTAX_ERROR.c_str(), i, argv[i], program_name.c_str());
-        auto ret = m_check_type(p, type_p, value, set_args);
-        if (ret != "")
-            return ret;
+        tokens.push_back(m_tokenize(args[i]));
+        tokens.back().position = i + 1;
+        tokens.back().length = args[i].size();
+        if (tokens.back().kind == Token::Kind::invalid)
+            tokens.back().value = args[i];
     }
-    // All is fine and values are affected to arguments
-    return "";
+    return tokens;
+}
 
+void Usage::Usage::m_batch_parse(const std::vector<Token>& tokens, Parse_State& state, bool parallel) const
+{
+    state.values.resize(m_argsorder.size());
+    state.set_args.assign(m_argsorder.size(), false);
+    state.defaults.assign(m_argsorder.size(), false);
+    state.message = m_parser(tokens, state, parallel);
+    state.parsed = state.message == "";
+}
+
+void Usage::Usage::m_batch_check(Parse_State& state, bool parallel) const
+{
+    if (state.parsed)
+        state.message = m_check_all(state, parallel);
 }
 
-void Usage::Usage::m_check_requirements(size_t arg_index, std::vector<bool>& set_args)
+template<typename F, typename G>
+void Usage::Usage::m_batch(size_t count, F tokenize, G store, Batch_Mode mode)
 {
-    if (!set_args[arg_index] && m_argsorder[arg_index]->named())
+    m_compile();
+    auto threads = std::max(1u, std::thread::hardware_concurrency());
+    if (mode == Batch_Mode::parallel && threads > 1 && count > 1)
     {
-        auto dval = dynamic_cast<Named_Arg*>(m_argsorder[arg_index])->default_value();
-        if (!dval.empty())
+        // each thread processes a contiguous share of the command lines
+        auto share = (count + threads - 1) / threads;
+        std::vector<std::thread> pool{};
+        for (size_t first = 0; first < count; first += share)
         {
-            // default value must be applied only if required args are effectively used
-            auto reqs = m_requirements.requirements(m_argsorder[arg_index]);
-            bool req_defined{ false };
-            if (reqs.empty())
-                req_defined = true;     // always apply default value for non-dependent args
-            for (auto req : reqs)
-            {
-                auto itr = std::find(m_argsorder.begin(), m_argsorder.end(), req);
-                if (itr != m_argsorder.end())
+            pool.emplace_back([&, first]()
                 {
-                    auto j = std::distance(m_argsorder.begin(), itr);
-                    if (set_args[j])
+                    auto last = std::min(first + share, count);
+                    for (size_t i = first; i < last; i++)
                     {
-                        req_defined = true;
-                        break;
+                        Parse_State state{};
+                        m_batch_parse(tokenize(i), state, false);
+                        m_batch_check(state, false);
+                        store(i, state);
                     }
-                }
-            }
-            if (req_defined)
+                });
+        }
+        for (auto& thread : pool)
+            thread.join();
+    }
+    else if (mode == Batch_Mode::pipeline && count > 1)
+    {
+        // the stages move the command lines through bounded queues in order, so only the command lines in the queues are held at a time
+        auto split = std::make_unique<Stage_Ring<std::vector<Token>>>();
+        auto matched = std::make_unique<Stage_Ring<Parse_State>>();
+        std::thread tokenizer{ [&]()
             {
-                m_argsorder[arg_index]->value.push_back(dval);
-                set_args[arg_index] = true;
-            }
+                for (size_t i = 0; i < count; i++)
+                    split->push(tokenize(i));
+            } };
+        std::thread matcher{ [&]()
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    auto tokens = split->pop();
+                    Parse_State state{};
+                    m_batch_parse(tokens, state, false);
+                    matched->push(std::move(state));
+                }
+            } };
+        for (size_t i = 0; i < count; i++)
+        {
+            auto state = matched->pop();
+            m_batch_check(state, false);
+            store(i, state);
+        }
+        tokenizer.join();
+        matcher.join();
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Parse_State state{};
+            m_batch_parse(tokenize(i), state, true);
+            m_batch_check(state, true);
+            store(i, state);
         }
     }
 }
 
-size_t Usage::Usage::m_check_argument(std::vector<bool>& set_args)
+std::vector<Usage::Parse_State> Usage::Usage::parse_batch(const std::vector<std::vector<std::string>>& command_lines, Batch_Mode mode)
 {
-    for (size_t i = 0; i < m_argsorder.size(); i++)
+    std::vector<Parse_State> states(command_lines.size());
+    m_batch(command_lines.size(), [&](size_t i) { return m_tokenize(command_lines[i]); },
+        [&](size_t i, Parse_State& state) { states[i] = std::move(state); }, mode);
+    return states;
+}
+
+std::vector<Usage::Pooled_State> Usage::Usage::parse_batch(const std::vector<std::vector<std::string>>& command_lines, Value_Pool& pool, Batch_Mode mode)
+{
+    std::vector<Pooled_State> states(command_lines.size());
+    m_batch(command_lines.size(), [&](size_t i) { return m_tokenize(command_lines[i]); },
+        [&](size_t i, Parse_State& state) { states[i] = pool.add(std::move(state)); }, mode);
+    return states;
+}
+
+std::vector<Usage::Process_Audit> Usage::Usage::audit_processes(Batch_Mode mode)
+{
+    // pid and command line of the processes of the program
+    std::vector<std::pair<int, std::string>> processes{};
+    auto wanted = program_stem(program_name);
+    std::error_code ec{};
+    for (std::filesystem::directory_iterator itr{ "/proc", ec }, end{}; !ec && itr != end; itr.increment(ec))
     {
-        if (!set_args[i] && m_argsorder[i]->required())
+        auto name = itr->path().filename().string();
+        if (name.empty() || name.find_first_not_of("0123456789") != std::string::npos)
+            continue;
+        // the processes that ended or that can't be read are skipped, as the kernel threads that have no command line
+        auto file = std::fopen((itr->path() / "cmdline").string().c_str(), "rb");
+        if (file == nullptr)
+            continue;
+        std::string command_line{};
+        std::array<char, 4096> buf;
+        size_t n{ 0 };
+        while ((n = std::fread(buf.data(), 1, buf.size(), file)) > 0)
+            command_line.append(buf.data(), n);
+        std::fclose(file);
+        if (command_line.empty())
+            continue;
+        std::string_view first{ command_line.c_str() };
+        bool found{ wanted.empty() || program_stem(first) == wanted };
+        // else the program may be the script of an interpreter, the first argument that is not an option
+        for (size_t start = first.size() + 1; !found && start < command_line.size();)
         {
-            // inspect args in direct conflict with the current one
-            auto cons = m_conflicts.conflicts(m_argsorder[i]);
-            bool con_defined{ false };
-            for (auto con : cons)
+            std::string_view arg{ command_line.c_str() + start };
+            if (arg.empty() || arg[0] != '-')
             {
-                auto itr = std::find(m_argsorder.begin(), m_argsorder.end(), con);
-                if (itr != m_argsorder.end())
+                if (program_stem(arg) == wanted)
                 {
-                    auto j = std::distance(m_argsorder.begin(), itr);
-                    if (set_args[j])
-                    {
-                        con_defined = true;
-                        break;
-                    }
+                    command_line.erase(0, start);
+                    found = true;
                 }
+                break;
             }
-            if (!con_defined)
-                return i;
+            start += arg.size() + 1;
         }
-        m_check_requirements(i, set_args);
+        if (found)
+            processes.emplace_back(std::atoi(name.c_str()), std::move(command_line));
     }
-    // All is fine
-    return -1;
+    std::sort(processes.begin(), processes.end());
+    std::vector<Process_Audit> audits(processes.size());
+    m_batch(processes.size(), [&](size_t i) { return m_tokenize(processes[i].second.data(), processes[i].second.size()); },
+        [&](size_t i, Parse_State& state) { audits[i] = { processes[i].first, std::move(state) }; }, mode);
+    return audits;
+}
+
+const std::string& Usage::Usage::help_term() const noexcept
+{
+    static const std::string none{};
+    return m_state.error == Parse_Error::help ? m_state.error_argument : none;
+}
+
+void Usage::Usage::restore(Parse_State state)
+{
+    assert(state.values.size() == m_argsorder.size() && state.set_args.size() == m_argsorder.size()
+        && state.defaults.size() == m_argsorder.size() && "The state does not match the arguments.");
+    m_state = std::move(state);
+    m_publish();
 }
 
-std::string Usage::Usage::m_check_dependencies(std::vector<bool>& set_args)
+std::string Usage::Usage::m_revalidate(size_t arg_index)
 {
     static const std::string switch_str{ switch_char };
     static const std::string REQUIRED_ARGUMENT{ "Missing required argument '%s' - see %s " + switch_str + help_arg + " for help." };
-    static const std::string CONFLICT{ "Arguments '%s' and '%s' can't be used together - see %s " + switch_str + help_arg + " for help." };
 
-    auto ret = m_check_argument(set_args);
-    if (ret != -1)
-        return str_utils::get_message(REQUIRED_ARGUMENT.c_str(), m_argsorder[ret]->name().c_str(), program_name.c_str());
-    for (size_t i = 0; i < m_argsorder.size(); i++)
+    if (m_state.message != "")
     {
-        if (set_args[i])
+        // the previous parameters break a rule: all the rules are checked again
+        m_state.error = Parse_Error::none;
+        m_state.error_argument.clear();
+        for (size_t i = 0; i < m_argsorder.size(); i++)
         {
-            for (size_t j = 0; j < m_argsorder.size(); j++)
+            if (m_state.defaults[i])
             {
-                if (i != j)
-                {
-                    if (set_args[j] && m_conflicts.in_conflict(m_argsorder[i], m_argsorder[j]))
-                        return str_utils::get_message(CONFLICT.c_str(), m_argsorder[i]->name().c_str(), m_argsorder[j]->name().c_str(), program_name.c_str());
-                    if (!set_args[j] && m_requirements.exists(m_argsorder[i], m_argsorder[j], true))
-                        return str_utils::get_message(REQUIRED_ARGUMENT.c_str(), m_argsorder[j]->name().c_str(), program_name.c_str());
-                }
+                m_state.values[i].clear();
+                m_state.set_args[i] = false;
+                m_state.defaults[i] = false;
             }
         }
+        m_state.message = m_check_all(m_state);
+        m_publish();
+        return m_state.message;
     }
-    // All is fine and values are affected to arguments
-    return "";
+    // the previous parameters were valid, so only the rules involving an argument which status changed can be broken
+    std::vector<size_t> affected{ arg_index };
+    // default values are evaluated again in the order of the arguments, as done by m_check_argument
+    std::set<size_t> pending{ arg_index };
+    for (auto dep : m_requirements.dependents(m_argsorder[arg_index]))
+        pending.insert(m_index(dep));
+    while (!pending.empty())
+    {
+        auto i = *pending.begin();
+        pending.erase(pending.begin());
+        if (m_state.set_args[i] && !m_state.defaults[i])
+            continue;
+        bool applies = m_default_applies(i, m_state);
+        if (applies == m_state.defaults[i])
+            continue;
+        m_state.values[i].clear();
+        if (applies && !static_cast<Named_Arg*>(m_argsorder[i])->default_function())
+            m_state.values[i].push_back(static_cast<Named_Arg*>(m_argsorder[i])->default_value());
+        m_state.set_args[i] = applies;
+        m_state.defaults[i] = applies;
+        if (i != arg_index)
+            affected.push_back(i);
+        for (auto dep : m_requirements.dependents(m_argsorder[i]))
+            pending.insert(m_index(dep));
+    }
+    std::sort(affected.begin(), affected.end());
+    std::vector<bool> is_affected(m_argsorder.size(), false);
+    for (auto i : affected)
+        is_affected[i] = true;
+    m_state.message = m_check_values(m_state, &affected);
+    // arguments with a default value are never required, so only the changed argument and its conflicts can be missing
+    constexpr size_t NONE{ SIZE_MAX };
+    size_t missing{ m_state.message == "" && m_missing(arg_index, m_state) ? arg_index : NONE };
+    for (auto con : m_conflicts.conflicts(m_argsorder[arg_index]))
+    {
+        auto j = m_index(con);
+        if (m_state.message == "" && j < missing && m_missing(j, m_state))
+            missing = j;
+    }
+    if (missing != NONE)
+    {
+        m_state.error = Parse_Error::missing_argument;
+        m_state.error_argument = m_argsorder[missing]->name();
+        m_state.message = str_utils::get_message(REQUIRED_ARGUMENT.c_str(), m_argsorder[missing]->name().c_str(), program_name.c_str());
+    }
+    for (size_t i = 0; i < m_argsorder.size() && m_state.message == ""; i++)
+    {
+        if (!m_state.set_args[i])
+            continue;
+        if (is_affected[i])
+        {
+            auto c = m_component[i];
+            for (auto k = m_component_offsets[c]; k < m_component_offsets[c + 1] && m_state.message == ""; k++)
+                m_state.message = m_check_pair(i, m_members[k], m_state);
+        }
+        else
+        {
+            for (auto j : affected)
+            {
+                m_state.message = m_check_pair(i, j, m_state);
+                if (m_state.message != "")
+                    break;
+            }
+        }
+    }
+    if (m_state.message == "")
+        m_state.message = m_check_paths(m_state, &affected);
+    for (auto i : affected)
+        m_publish(i);
+    m_update_defaults();
+    return m_state.message;
 }
 
-std::string Usage::Usage::set_parameters(int argc, char* argv[])
+std::string Usage::Usage::set_parameter(const std::string& arg)
 {
-    if (argc == 0)
-        return "No argument to evaluate.";
-    std::vector<bool> set_args(m_argsorder.size(), false);
-    auto ret = m_parser(argc, argv, set_args);
+    static const std::string switch_str{ switch_char };
+    static const std::string SYNTAX_ERROR{ "Error found in argument '%s' - see %s " + switch_str + help_arg + " for help." };
+    static const std::string LIMIT_EXCEEDED{ "Argument exceeds the limit of %zu bytes - see %s " + switch_str + help_arg + " for help." };
+    static const std::string TOTAL_EXCEEDED{ "Command line exceeds the limit of %zu bytes - see %s " + switch_str + help_arg + " for help." };
+
+    assert(m_state.values.size() == m_argsorder.size() && !m_argsorder.empty() && "Parameters must be set before being updated.");
+    if (!m_state.parsed)
+        return m_state.message;         // the command line can't be read, the change does not fix it
+    if (arg.empty())
+        return str_utils::get_message(SYNTAX_ERROR.c_str(), arg.c_str(), program_name.c_str());
+    if (limits.max_value_length != 0 && arg.size() > limits.max_value_length)
+        return str_utils::get_message(LIMIT_EXCEEDED.c_str(), limits.max_value_length, program_name.c_str());
+    // the bytes of the replaced values are still counted, as if the argument was appended to the command line
+    if (limits.max_bytes != 0 && (arg.size() > limits.max_bytes || m_state.bytes > limits.max_bytes - arg.size()))
+        return str_utils::get_message(TOTAL_EXCEEDED.c_str(), limits.max_bytes, program_name.c_str());
+    m_compile();
+    auto token = m_tokenize(arg);
+    if (token.kind != Token::Kind::named)
+        return str_utils::get_message(SYNTAX_ERROR.c_str(), arg.c_str(), program_name.c_str());
+    auto entry = m_find_named(token.name);
+    bool status_changed{ entry == nullptr || !m_state.set_args[entry->index] || m_state.defaults[entry->index] };
+    // the state is not modified if the check fails
+    auto deprecated = m_state.deprecated.size();
+    size_t arg_index;
+    Parse_Error error;
+    auto ret = m_check_type(token.name, token.type, token.value, m_state, arg_index, error, true);
     if (ret != "")
         return ret;
-    ret = m_check_dependencies(set_args);
-    return ret;
+    m_state.bytes += arg.size();
+    if (m_state.deprecated.size() > deprecated)
+        m_count_deprecated(m_state.deprecated.back());
+    if (!status_changed && m_state.message == "")
+    {
+        // only the value changed
+        std::vector<size_t> changed{ arg_index };
+        m_state.message = m_check_values(m_state, &changed);
+        if (m_state.message == "")
+            m_state.message = m_check_paths(m_state, &changed);
+        m_publish(arg_index);
+        m_update_defaults();
+        return m_state.message;
+    }
+    return m_revalidate(arg_index);
 }
 
-/* void Usage::Usage::create_syntax()
+std::string Usage::Usage::unset_parameter(const std::string& name)
 {
-    m_syntax_string = program_name + " ";
-    auto reqs = m_requirements.get();
-    std::vector<std::pair<size_t, size_t>> requirements{};                     // first is the requirement and second the dependent
-    std::vector<std::pair<size_t, size_t>> counts(m_argsorder.size(), { 0, 0 });  // first is the count as requirement and second the count as dependent
-    for (auto req : reqs)
+    assert(m_state.values.size() == m_argsorder.size() && !m_argsorder.empty() && "Parameters must be set before being updated.");
+    auto itr = m_arguments.find(name);
+    assert(itr != m_arguments.end() && "Unknown argument name.");
+    if (!m_state.parsed)
+        return m_state.message;         // the command line can't be read, the change does not fix it
+    m_compile();
+    auto arg_index = m_index((*itr).second);
+    if (!m_state.set_args[arg_index] || m_state.defaults[arg_index])
+        return m_state.message;         // nothing to remove
+    m_state.values[arg_index].clear();
+    m_state.set_args[arg_index] = false;
+    return m_revalidate(arg_index);
+}
+
+void Usage::Usage::create_syntax()
+{
+    static const std::string switch_str{ switch_char };
+
+    // one pass over the arguments, the requirements and the conflicts
+    m_compile();
+    auto count = m_argsorder.size();
+    // groups of arguments in conflict, by union-find
+    std::vector<size_t> parent(count);
+    for (size_t i = 0; i < count; i++)
+        parent[i] = i;
+    auto root = [&parent](size_t i)
     {
-        auto dep_itr = std::find(m_argsorder.begin(), m_argsorder.end(), req.first);
-        auto req_itr = std::find(m_argsorder.begin(), m_argsorder.end(), req.second);
-        assert((req_itr != m_argsorder.end() && dep_itr != m_argsorder.end()) && "Unexpected issue in function create_syntax.");
-        auto dep_idx = std::distance(m_argsorder.begin(), dep_itr);
-        auto req_idx = std::distance(m_argsorder.begin(), req_itr);
-        requirements.push_back({ req_idx, dep_idx });
-        counts[req_idx].first++;
-        counts[dep_idx].second++;
-    }
-    for (size_t i = 1; i < m_argsorder.size(); i++)
-        // adds a requirement with preceding arg for orphan unnamed args
-        if (!m_argsorder[i]->named() && !m_requirements.has_requirements(m_argsorder[i]))
-        {
-            requirements.push_back({ i - 1, i });
-            counts[i - 1].first++;
-            counts[i].second++;
-        }
-    std::vector<std::vector<size_t>> conflicts{};
-    std::vector<size_t> con_idx(m_argsorder.size(), -1);
-    for (size_t i = 0; i < m_argsorder.size(); i++)
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    std::vector<bool> in_conflict(count, false);
+    for (auto& con : m_conflicts.get())
+    {
+        auto a = m_indexes[con.first];
+        auto b = m_indexes[con.second];
+        in_conflict[a] = in_conflict[b] = true;
+        auto ra = root(a);
+        auto rb = root(b);
+        if (ra != rb)
+            parent[std::max(ra, rb)] = std::min(ra, rb);
+    }
+    // a dependent that has only one requirement and no conflict is displayed before its requirement
+    std::vector<size_t> requirements(count, 0);
+    std::vector<size_t> requirement(count, 0);
+    for (auto& req : m_requirements.get())
+    {
+        auto dep = m_indexes[req.first];
+        requirements[dep]++;
+        requirement[dep] = m_indexes[req.second];
+    }
+    std::vector<bool> is_attached(count, false);
+    for (size_t i = 0; i < count; i++)
+        is_attached[i] = requirements[i] == 1 && !in_conflict[i];
+    // dependents that require each other in a cycle: the first one found is displayed as the root of the others
+    std::vector<char> visited(count, 0);        // 1 while following the requirements, 2 when done
+    for (size_t i = 0; i < count; i++)
     {
-        if (con_idx[i] == -1)       // each arg can be in only one group of conflict
+        auto j = i;
+        while (is_attached[j] && visited[j] == 0)
         {
-            auto cons = m_conflicts.all_conflicts(m_argsorder[i]);
-            std::vector<size_t> row{};
-            for (auto con : cons)
-            {
-                auto arg_itr = std::find(m_argsorder.begin(), m_argsorder.end(), con);
-                auto arg_idx = std::distance(m_argsorder.begin(), arg_itr);
-                row.push_back(arg_idx);
-                con_idx[arg_idx] = conflicts.size();
-            }
-            conflicts.push_back(row);
+            visited[j] = 1;
+            j = requirement[j];
         }
+        if (visited[j] == 1)
+            is_attached[j] = false;
+        for (j = i; visited[j] == 1; j = requirement[j])
+            visited[j] = 2;
     }
-    auto group_base = counts.size();                       // groups id starts at this index in table counts
-    std::vector<std::vector<size_t>> groups{};
-    bool transforms{ true };
-    while (transforms)
+    std::vector<std::vector<size_t>> attached(count);
+    for (size_t i = 0; i < count; i++)
+        if (is_attached[i])
+            attached[requirement[i]].push_back(i);
+
+    auto token = [this](size_t i)
     {
-        transforms = false;
-        auto req_itr = requirements.begin();
-        while (req_itr != requirements.end())
+        auto arg = m_argsorder[i];
+        if (!arg->named())
+            return static_cast<const Unnamed_Arg*>(arg)->many ? arg->name() + "..." : arg->name();
+        auto named = static_cast<Named_Arg*>(arg);
+        auto shortcut = named->shortcut_char;
+        // the key of a string argument is its shortcut, the name follows ; the other arguments give their name then their shortcut
+        if (named->type() == Argument_Type::string)
+            return switch_str + (shortcut != ' ' ? std::string{ shortcut } : arg->name()) + ":" + arg->name();
+        auto key = switch_str + arg->name() + (shortcut != ' ' ? std::string{ ',', shortcut } : std::string{});
+        return named->type() == Argument_Type::boolean ? key + "{+|-}" : key;
+    };
+    // appends the argument preceded by its attached dependents ; an optional argument is delimited by [] and a required one with dependents by ()
+    std::function<void(size_t, bool)> append = [&](size_t i, bool delimit)
+    {
+        bool required{ m_argsorder[i]->required() };
+        delimit = delimit && (!required || !attached[i].empty());
+        if (delimit)
+            m_syntax_string += required ? '(' : '[';
+        for (auto dep : attached[i])
         {
-            // links orphan dependents to their requirement
-            if (counts[(*req_itr).second].second == 1 && counts[(*req_itr).second].first == 0
-                && (counts[(*req_itr).first].first != 0 || counts[(*req_itr).first].second != 0))
-            {
-                std::vector<size_t> row{ (*req_itr).first, (*req_itr).second };
-                auto group_id = group_base + groups.size();
-                groups.push_back(row);
-                counts.push_back({ 0, 0 });
-                auto con1 = con_idx[row[0]];
-                auto con2 = con_idx[row[1]];
-                assert((con1 == con2 || con1 == -1 || con2 == -1) && "Sorry I don't know how to handle requirements involved in distinct conflicts.");
-                if (con1 != -1)
-                    con_idx.push_back(con1);
-                else
-                    con_idx.push_back(con2);
-                for (auto req : requirements)
-                {
-                    if (req.first == row[0])
-                    {
-                        counts[row[0]].first--;
-                        req.first = group_id;
-                        counts[group_id].first++;
-                    }
-                    else if (req.second == row[0])
-                    {
-                        counts[row[0]].second--;
-                        req.second = group_id;
-                        counts[group_id].second++;
-                    }
-                }
-                req_itr = requirements.erase(req_itr);
-                transforms = true;
-            }
-            else
-                ++req_itr;
+            append(dep, true);
+            m_syntax_string += ' ';
         }
-        req_itr = requirements.begin();
-        while (req_itr != requirements.end())
+        m_syntax_string += token(i);
+        if (delimit)
+            m_syntax_string += required ? ')' : ']';
+    };
+
+    m_syntax_string = program_name;
+    // unnamed arguments first, then the other arguments and finally the groups of arguments in conflict
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < count; i++)
         {
-            // links orphan requirements to their dependent
-            if (counts[(*req_itr).first].first == 1 && counts[(*req_itr).first].second == 0
-                && counts[(*req_itr).second].first != 0 && counts[(*req_itr).second].second == 1)
-            {
-                std::vector<size_t> row{ (*req_itr).first, (*req_itr).second };
-                auto group_id = group_base + groups.size();
-                groups.push_back(row);
-                counts.push_back({ 0, 0 });
-                counts[row[0]].first--;
-                counts[row[1]].second--;
-                auto con1 = con_idx[row[0]];
-                auto con2 = con_idx[row[1]];
-                assert((con1 == con2 || con1 == -1 || con2 == -1) && "Sorry I don't know how to handle requirements involved in distinct conflicts.");
-                if (con1 != -1)
-                    con_idx.push_back(con1);
-                else
-                    con_idx.push_back(con2);
-                for (auto req : requirements)
-                    if (req.first == row[1])
-                    {
-                        counts[row[1]].first--;
-                        req.first = group_id;
-                        counts[group_id].first++;
-                    }
-                req_itr = requirements.erase(req_itr);
-                transforms = true;
-            }
+            if (is_attached[i] || in_conflict[i] || m_argsorder[i]->named() == (pass == 0))
+                continue;
+            m_syntax_string += ' ';
+            append(i, true);
         }
     }
-    size_t start{ 0 };
-    if (m_requirements.has_requirements(m_argsorder[0]))
+    std::vector<std::vector<size_t>> groups(count);
+    for (size_t i = 0; i < count; i++)
+        if (in_conflict[i])
+            groups[root(i)].push_back(i);
+    for (auto& group : groups)
     {
-        // search for starting argument
-        auto req_init = m_requirements.all_requirements(m_argsorder[0]);
-        size_t max_size{ 0 };
-        auto req_itr = req_init.begin();
-        auto req_found = req_init.end();
-        while (req_itr != req_init.end())
+        if (group.empty())
+            continue;
+        bool required{ m_argsorder[group[0]]->required() };
+        m_syntax_string += required ? " (" : " [";
+        for (size_t k = 0; k < group.size(); k++)
         {
-            // search for the longest chain
-            if ((*req_itr).size() > max_size)
-            {
-                max_size = (*req_itr).size();
-                req_found = req_itr;
-            }
-            ++req_itr;
+            if (k != 0)
+                m_syntax_string += " | ";
+            append(group[k], false);
         }
-        auto arg_itr = std::find(m_argsorder.begin(), m_argsorder.end(), (*req_found).back());
-        start = std::distance(m_argsorder.begin(), arg_itr);
+        m_syntax_string += required ? ')' : ']';
     }
-    // TODO
     m_syntax_valid = true;
-} */
+}
+
+const std::string& Usage::Usage::get_syntax()
+{
+    if (!m_syntax_valid)
+        create_syntax();
+    return m_syntax_string;
+}
 
-namespace Usage
+std::string Usage::Usage::compile_syntax(const std::string& syntax, const std::unordered_map<std::string, std::string>& helpstrings)
 {
-    std::ostream& operator<<(std::ostream& os, Usage& us)
+    static const std::string UNKNOWN_ARGUMENT{ "Help string given for the unknown argument '%s'." };
+
+    auto table = compiled_syntax(syntax, switch_char);
+    if (!table->error.empty())
+        return table->error;
+    for (auto& help : helpstrings)
+        if (table->names.find(help.first) == table->names.end())
+            return str_utils::get_message(UNKNOWN_ARGUMENT.c_str(), help.first.c_str());
+    remove_all();
+    for (auto& spec : table->arguments)
     {
-        if (!us.syntax_is_valid())
-        {
-            // TODO review with create_syntax
-            // us.create_syntax();
-        }
-        os << us.description << std::endl << std::endl;
-        os << "Syntax:" << std::endl;
-        os << "    " << us.m_syntax_string << std::endl << std::endl;
-        // argsorder is used to list the elements in the same order they were added
-        // do a first pass to determine the max length
-        size_t max_length{ 0 };
-        auto itr = us.m_argsorder.begin();
-        while (itr != us.m_argsorder.end())
+        auto help = helpstrings.find(spec.name);
+        if (spec.named)
         {
-            auto lgth = (*itr)->name().length();
-            if ((*itr)->named() && dynamic_cast<Named_Arg*>(*itr)->shortcut_char != ' ')
-                lgth += 3;
-            if (lgth > max_length)
-                max_length = lgth;
-            ++itr;
+            Named_Arg arg{ spec.name };
+            arg.set_type(spec.type);
+            arg.shortcut_char = spec.shortcut;
+            arg.set_required(spec.required);
+            if (help != helpstrings.end())
+                arg.helpstring = (*help).second;
+            add_Argument(arg);
         }
-        std::string filler{ "" };
-        filler.append(max_length, ' ');
-        itr = us.m_argsorder.begin();
-        while (itr != us.m_argsorder.end())
+        else
         {
-            os << "    " << (*itr)->name();
-            auto lgth = (*itr)->name().length();
-            if ((*itr)->named() && dynamic_cast<Named_Arg*>(*itr)->shortcut_char != ' ')
-            {
-                os << ", " << dynamic_cast<Named_Arg*>(*itr)->shortcut_char;
-                lgth += 3;
-            }
-            if (filler.length() > lgth)
-            {
-                std::string fill2{ "" };
-                fill2.append(max_length - lgth, ' ');
-                os << fill2;
-            }
-            // display the helpstring with indent
-            std::stringstream ostr;
-            ostr.str((*itr)->helpstring);
-            std::array<char, 255> buf;
-            bool indent{ false };
-            while (ostr.getline(&buf[0], 255, '\n'))
-            {
-                if (indent)
-                    os << "    " << filler;
-                else
-                    indent = true;
-                os << "    " << &buf[0] << std::endl;
-            }
-            if ((*itr)->named())
-            {
-                auto dval = dynamic_cast<Named_Arg*>(*itr)->default_value();
-                if (!dval.empty())
-                {
-                    os << "    " << filler << "    ";
-                    if (dval == "\t")
-                        os << "'Tab'";
-                    else if (dval == " ")
-                        os << "'Space'";
-                    else
-                        os << "'" << dval << "'";
-                    os << " by default." << std::endl;
-                }
-            }
-            ++itr;
+            Unnamed_Arg arg{ spec.name };
+            arg.many = spec.many;
+            arg.set_required(spec.required);
+            if (help != helpstrings.end())
+                arg.helpstring = (*help).second;
+            add_Argument(arg);
         }
-        os << std::endl;
-        os << us.usage << std::endl;
-        return os;
     }
+    for (auto& req : table->requirements)
+        add_requirement(table->arguments[req.first].name, table->arguments[req.second].name);
+    for (auto& con : table->conflicts)
+        add_conflict(table->arguments[con.first].name, table->arguments[con.second].name);
+    set_syntax(syntax);
+    return "";
+}
+
+Usage::Value_Pool::Id Usage::Value_Pool::intern(std::string_view value)
+{
+    auto hash = std::hash<std::string_view>{}(value);
+    auto shard_index = hash % SHARDS;
+    auto& shard = m_shards[shard_index];
+    std::lock_guard<std::mutex> lock{ shard.mutex };
+    auto itr = shard.ids.find(value);
+    if (itr != shard.ids.end())
+        return (*itr).second;
+    assert(shard.values.size() < (UINT32_MAX - shard_index) / SHARDS && "Too many values in the pool.");
+    auto id = static_cast<Id>(shard.values.size() * SHARDS + shard_index);
+    shard.values.emplace_back(value);
+    shard.ids.emplace(shard.values.back(), id);
+    return id;
+}
+
+const std::string& Usage::Value_Pool::value(Id id) const
+{
+    auto& shard = m_shards[id % SHARDS];
+    assert(id / SHARDS < shard.values.size() && "Unknown value identifier.");
+    return shard.values[id / SHARDS];
+}
+
+size_t Usage::Value_Pool::size() const noexcept
+{
+    size_t size{ 0 };
+    for (auto& shard : m_shards)
+        size += shard.values.size();
+    return size;
+}
+
+Usage::Pooled_State Usage::Value_Pool::add(Parse_State state)
+{
+    Pooled_State pooled{};
+    pooled.offsets.reserve(state.values.size() + 1);
+    for (auto& values : state.values)
+    {
+        pooled.offsets.push_back(static_cast<std::uint32_t>(pooled.values.size()));
+        for (auto& value : values)
+            pooled.values.push_back(intern(value));
+    }
+    pooled.offsets.push_back(static_cast<std::uint32_t>(pooled.values.size()));
+    state.values.clear();
+    state.values.shrink_to_fit();
+    pooled.state = std::move(state);
+    return pooled;
+}
+
+Usage::Parse_State Usage::Value_Pool::expand(const Pooled_State& pooled) const
+{
+    auto state = pooled.state;
+    state.values.resize(pooled.offsets.empty() ? 0 : pooled.offsets.size() - 1);
+    for (size_t i = 0; i < state.values.size(); i++)
+    {
+        for (auto k = pooled.offsets[i]; k < pooled.offsets[i + 1]; k++)
+            state.values[i].push_back(value(pooled.values[k]));
+    }
+    return state;
 }
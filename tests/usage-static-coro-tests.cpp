@@ -0,0 +1,96 @@
+#include <coroutine>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <usage-static-coro.hpp>
+
+// source whose arguments arrive one at a time: each next() suspends the parsing until the driver resumes it
+class Queue_Source
+{
+public:
+	explicit Queue_Source(std::vector<std::string> args) : m_args{ std::move(args) } {}
+
+	struct Awaiter
+	{
+		Queue_Source* source;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle) noexcept { source->m_waiting = handle; }
+		std::optional<std::string> await_resume()
+		{
+			if (source->m_next == source->m_args.size())
+				return std::nullopt;
+			return source->m_args[source->m_next++];
+		}
+	};
+	Awaiter next() noexcept { return Awaiter{ this }; }
+
+	// resumes the parsing waiting for an argument, false if none is waiting
+	bool deliver()
+	{
+		if (!m_waiting)
+			return false;
+		std::exchange(m_waiting, {}).resume();
+		return true;
+	}
+
+	size_t delivered() const noexcept { return m_next; }
+
+private:
+	std::vector<std::string> m_args;
+	size_t m_next{ 0 };
+	std::coroutine_handle<> m_waiting{};
+};
+
+class UsageCoroTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		Usage::Named_Arg e{ "extension" };
+		e.set_type(Usage::Argument_Type::string);
+		e.shortcut_char = 'e';
+		e.set_required(true);
+		us.add_Argument(e);
+		Usage::Named_Arg r{ "reverse" };
+		r.shortcut_char = 'r';
+		us.add_Argument(r);
+	}
+
+	Usage::Usage us{ "program.exe" };
+	std::string sw{ us.switch_char };
+};
+
+TEST_F(UsageCoroTest, Parse_Async)
+{
+	Queue_Source source{ { sw + "e:txt", sw + "r" } };
+	auto task = Usage::parse_async(us, source);
+	task.start();
+	size_t resumes{ 0 };
+	while (source.deliver())
+		resumes++;
+	ASSERT_TRUE(task.done());
+	EXPECT_EQ(resumes, 3);          // two arguments and the end of the command line
+	auto& state = task.result();
+	EXPECT_STREQ(state.message.c_str(), "");
+	us.restore(state);
+	EXPECT_EQ(us.get_values("extension"), std::vector<std::string>{ "txt" });
+	EXPECT_EQ(us.get_values("reverse"), std::vector<std::string>{ "true" });
+}
+
+TEST_F(UsageCoroTest, Parse_Async_Error)
+{
+	// the source is read to the end of the command line even after an error
+	Queue_Source source{ { sw + "unknown", sw + "e:txt" } };
+	auto task = Usage::parse_async(us, source);
+	task.start();
+	while (source.deliver())
+		;
+	ASSERT_TRUE(task.done());
+	EXPECT_EQ(source.delivered(), 2);
+	EXPECT_STRNE(task.result().message.c_str(), "");
+	EXPECT_EQ(task.result().error, Usage::Parse_Error::unknown_argument);
+}
@@ -1,3 +1,17 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#ifdef __linux__
+#include <csignal>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include <gtest/gtest.h>
 #include <usage-static.hpp>
 
@@ -299,3 +313,864 @@ TEST_F(UsageTest, Set_Parameters8)
 	auto msg = us.set_parameters((int)argv.size(), &argv[0]);
 	EXPECT_STREQ(msg.c_str(), "");
 }
+
+TEST_F(UsageTest, Set_Parameter0)
+{
+	// changing a value keeps the parameters valid
+#ifdef _WIN32
+	std::vector<char*> argv{ "program.exe", "files*.txt", "/f:3,7", "/r" };
+#elif __unix__
+	std::vector<char*> argv{ "program.exe", "files*.txt", "-f:3,7", "-r" };
+#endif
+	auto msg = us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_STREQ(msg.c_str(), "");
+	msg = us.set_parameter(std::string{ us.switch_char } + "f:1L5");
+	EXPECT_STREQ(msg.c_str(), "");
+	EXPECT_EQ(us.get_values("fixed"), std::vector<std::string>{ "1L5" });
+}
+
+TEST_F(UsageTest, Set_Parameter1)
+{
+	// setting an argument gives the same result as a full parsing
+#ifdef _WIN32
+	std::vector<char*> argv{ "program.exe", "files*.txt", "/f:3,7" };
+	std::vector<char*> argv2{ "program.exe", "files*.txt", "/f:3,7", "/p:2" };
+#elif __unix__
+	std::vector<char*> argv{ "program.exe", "files*.txt", "-f:3,7" };
+	std::vector<char*> argv2{ "program.exe", "files*.txt", "-f:3,7", "-p:2" };
+#endif
+	auto expected = us.set_parameters((int)argv2.size(), &argv2[0]);
+	us.set_parameters((int)argv.size(), &argv[0]);
+	auto msg = us.set_parameter(std::string{ us.switch_char } + "p:2");
+	EXPECT_STREQ(msg.c_str(), expected.c_str());
+	// removing the argument restores the valid parameters, with the default value of the dependent argument removed
+	msg = us.unset_parameter("position");
+	EXPECT_STREQ(msg.c_str(), "");
+	EXPECT_TRUE(us.get_values("field_separator").empty());
+}
+
+TEST_F(UsageTest, Set_Parameter2)
+{
+	// the default value of a dependent argument is applied when its requirement is set
+#ifdef _WIN32
+	std::vector<char*> argv{ "program.exe", "files*.txt", "/f:3,7" };
+#elif __unix__
+	std::vector<char*> argv{ "program.exe", "files*.txt", "-f:3,7" };
+#endif
+	us.set_parameters((int)argv.size(), &argv[0]);
+	auto msg = us.unset_parameter("fixed");
+	EXPECT_STREQ(msg.c_str(), us.set_parameters(2, &argv[0]).c_str());
+	us.set_parameters(2, &argv[0]);
+	msg = us.set_parameter(std::string{ us.switch_char } + "p:2");
+	EXPECT_STREQ(msg.c_str(), "");
+	EXPECT_EQ(us.get_values("field_separator"), std::vector<std::string>{ "\t" });
+}
+
+TEST_F(UsageTest, Snapshot_Restore)
+{
+#ifdef _WIN32
+	std::vector<char*> argv{ "program.exe", "files*.txt", "/f:3,7" };
+#elif __unix__
+	std::vector<char*> argv{ "program.exe", "files*.txt", "-f:3,7" };
+#endif
+	us.set_parameters((int)argv.size(), &argv[0]);
+	auto state = us.snapshot();
+	auto msg = us.set_parameter(std::string{ us.switch_char } + "p:2");
+	EXPECT_STRNE(msg.c_str(), "");
+	us.restore(state);
+	EXPECT_TRUE(us.get_values("position").empty());
+	EXPECT_STREQ(us.unset_parameter("extension").c_str(), "");
+}
+
+TEST_F(UsageTest, Set_Parameters_Candidates)
+{
+	Usage::Usage old{ "program.exe" };
+	Usage::Unnamed_Arg file{ "file" };
+	file.set_required(true);
+	old.add_Argument(file);
+#ifdef _WIN32
+	std::vector<char*> argv{ "program.exe", "files*.txt", "/f:3,7" };
+#elif __unix__
+	std::vector<char*> argv{ "program.exe", "files*.txt", "-f:3,7" };
+#endif
+	std::vector<Usage::Usage*> candidates{ &old, &us };
+	EXPECT_EQ(Usage::Usage::set_parameters(candidates, (int)argv.size(), &argv[0]), 1);
+	EXPECT_EQ(us.get_values("fixed"), std::vector<std::string>{ "3,7" });
+	EXPECT_EQ(Usage::Usage::set_parameters(candidates, 2, &argv[0]), 0);
+	// each candidate splits the command line with its own limits
+	Usage::Usage strict{ "program.exe" };
+	strict.add_Argument(file);
+	strict.limits.max_value_length = 4;
+	candidates = { &strict, &us };
+	EXPECT_EQ(Usage::Usage::set_parameters(candidates, (int)argv.size(), &argv[0]), 1);
+	EXPECT_EQ(strict.error(), Usage::Parse_Error::limit_exceeded);
+	EXPECT_EQ(us.get_values("fixed"), std::vector<std::string>{ "3,7" });
+}
+
+TEST_F(UsageTest, Aliases)
+{
+	Usage::Named_Arg m{ "mode" };
+	m.set_type(Usage::Argument_Type::string);
+	us.add_Argument(m);
+	us.add_alias("ext", "extension");
+	us.add_alias("old_fixed", "fixed", true);
+	us.add_rewrite("fast", "mode", "fast", true);
+#ifdef _WIN32
+	std::vector<char*> argv{ "program.exe", "files*.txt", "/old_fixed:3,7", "/ext:txt", "/fast" };
+#elif __unix__
+	std::vector<char*> argv{ "program.exe", "files*.txt", "-old_fixed:3,7", "-ext:txt", "-fast" };
+#endif
+	auto msg = us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_STREQ(msg.c_str(), "");
+	EXPECT_EQ(us.get_values("fixed"), std::vector<std::string>{ "3,7" });
+	EXPECT_EQ(us.get_values("extension"), std::vector<std::string>{ "txt" });
+	EXPECT_EQ(us.get_values("mode"), std::vector<std::string>{ "fast" });
+	auto uses = us.get_deprecated_uses();
+	EXPECT_EQ(uses.size(), 2);
+	EXPECT_EQ(uses["old_fixed"], 1);
+	EXPECT_EQ(uses["fast"], 1);
+}
+
+TEST_F(UsageDeathTest, Add_Alias_On_Existing_Name)
+{
+	EXPECT_DEATH(us.add_alias("reverse", "fixed"), "");
+}
+
+TEST_F(UsageTest, Validators)
+{
+	auto b = static_cast<Usage::Named_Arg*>(us.get_Argument("begin"));
+	b->set_range(1, 1000);
+	auto d = static_cast<Usage::Named_Arg*>(us.get_Argument("date_format"));
+	d->set_pattern("[dmy](\\.[dmy]){2}");
+	auto n = static_cast<Usage::Named_Arg*>(us.get_Argument("decimal_separator"));
+	n->set_choices({ ".", "," });
+#ifdef _WIN32
+	std::vector<char*> argv{ "program.exe", "files*.txt", "/f:3,7", "/b:10", "/d:y.m.d", "/n:," };
+	std::vector<char*> argv2{ "program.exe", "files*.txt", "/f:3,7", "/b:0" };
+	std::vector<char*> argv3{ "program.exe", "files*.txt", "/f:3,7", "/d:yyyy" };
+	std::vector<char*> argv4{ "program.exe", "files*.txt", "/f:3,7", "/n:;" };
+#elif __unix__
+	std::vector<char*> argv{ "program.exe", "files*.txt", "-f:3,7", "-b:10", "-d:y.m.d", "-n:," };
+	std::vector<char*> argv2{ "program.exe", "files*.txt", "-f:3,7", "-b:0" };
+	std::vector<char*> argv3{ "program.exe", "files*.txt", "-f:3,7", "-d:yyyy" };
+	std::vector<char*> argv4{ "program.exe", "files*.txt", "-f:3,7", "-n:;" };
+#endif
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(us.error(), Usage::Parse_Error::none);
+	us.set_parameters((int)argv2.size(), &argv2[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::invalid_value);
+	EXPECT_EQ(us.snapshot().error_argument, "begin");
+	us.set_parameters((int)argv3.size(), &argv3[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::invalid_value);
+	us.set_parameters((int)argv4.size(), &argv4[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::invalid_value);
+	std::string sw{ us.switch_char };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	for (auto number : { "+10", "1e2", "999.5", "1000" })
+		EXPECT_STREQ(us.set_parameter(sw + "b:" + number).c_str(), "") << number;
+	for (auto number : { "nan", "inf", "-inf", " 10", "10 ", "0x10", "1e999", "10,5", "+-5", "+", "" })
+		EXPECT_STRNE(us.set_parameter(sw + "b:" + number).c_str(), "") << number;
+}
+
+TEST_F(UsageTest, Path_Check)
+{
+	auto dir = std::filesystem::temp_directory_path() / "usage-static-tests";
+	std::filesystem::create_directories(dir);
+	auto file = (dir / "data.txt").string();
+	std::ofstream{ file } << "data";
+	auto missing = (dir / "missing.txt").string();
+	auto folder = dir.string();
+	us.get_Argument("file")->path_check = Usage::Path_Check::exists | Usage::Path_Check::is_file;
+	std::string fixed{ std::string{ us.switch_char } + "f:3,7" };
+	std::vector<char*> argv{ "program.exe", &file[0], &fixed[0] };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	// all the invalid paths are reported
+	std::vector<char*> argv2{ "program.exe", &file[0], &missing[0], &folder[0], &fixed[0] };
+	auto msg = us.set_parameters((int)argv2.size(), &argv2[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::invalid_path);
+	EXPECT_NE(msg.find("(not found)"), std::string::npos);
+	EXPECT_NE(msg.find("(not a file)"), std::string::npos);
+	std::filesystem::remove_all(dir);
+}
+
+TEST_F(UsageTest, Glob)
+{
+	auto dir = std::filesystem::temp_directory_path() / "usage-static-glob";
+	std::filesystem::create_directories(dir / "sub" / "deep");
+	for (auto name : { "b.csv", "a.csv", "c.txt", "sub/d.csv", "sub/deep/e.csv" })
+		std::ofstream{ dir / name } << "data";
+	auto file = static_cast<Usage::Unnamed_Arg*>(us.get_Argument("file"));
+	file->glob = true;
+	auto pattern = dir.string() + "/**/*.csv";
+	auto literal = dir.string() + "/*.none";
+	std::string fixed{ std::string{ us.switch_char } + "f:3,7" };
+	std::vector<char*> argv{ "program.exe", &pattern[0], &literal[0], &fixed[0] };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	std::vector<std::string> expected{ (dir / "a.csv").string(), (dir / "b.csv").string(), (dir / "sub" / "d.csv").string(),
+		(dir / "sub" / "deep" / "e.csv").string(), literal };
+	EXPECT_EQ(us.get_values("file"), expected);
+	// the paths reached several times are counted once against the limit
+	auto twice = dir.string() + "/**/**/*.csv";
+	argv = { "program.exe", &twice[0], &fixed[0] };
+	expected.pop_back();
+	us.limits.max_values = 4;
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(us.get_values("file"), expected);
+	auto states = us.parse_batch({ { twice, fixed }, { twice, fixed } }, Usage::Batch_Mode::parallel);
+	EXPECT_EQ(states[1].values[0], expected);
+	us.limits.max_values = 3;
+	us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::limit_exceeded);
+	// a trailing ** matches the files and the directories below, not the directory itself
+	us.limits.max_values = 0;
+	auto below = dir.string() + "/**";
+	argv = { "program.exe", &below[0], &fixed[0] };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	expected = { (dir / "a.csv").string(), (dir / "b.csv").string(), (dir / "c.txt").string(), (dir / "sub").string(),
+		(dir / "sub" / "d.csv").string(), (dir / "sub" / "deep").string(), (dir / "sub" / "deep" / "e.csv").string() };
+	EXPECT_EQ(us.get_values("file"), expected);
+	// a bare ** matches the entries below the current directory, with relative paths
+	auto current = std::filesystem::current_path();
+	std::filesystem::current_path(dir);
+	std::string any{ "**" };
+	argv = { "program.exe", &any[0], &fixed[0] };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	std::filesystem::current_path(current);
+	expected = { "a.csv", "b.csv", "c.txt", "sub", (std::filesystem::path{ "sub" } / "d.csv").string(), (std::filesystem::path{ "sub" } / "deep").string(),
+		(std::filesystem::path{ "sub" } / "deep" / "e.csv").string() };
+	EXPECT_EQ(us.get_values("file"), expected);
+	std::filesystem::remove_all(dir);
+}
+
+TEST_F(UsageTest, Quoted_Values)
+{
+#ifdef _WIN32
+	std::vector<char*> argv{ "program.exe", "\"my files\\t\"*.txt", "C:\\data\\x.txt", "/p:2", "/s:\"\\t\"", "/d:\"d\\\"m\\\\\\x79\"" };
+#elif __unix__
+	std::vector<char*> argv{ "program.exe", "\"my files\\t\"*.txt", "C:\\data\\x.txt", "-p:2", "-s:\"\\t\"", "-d:\"d\\\"m\\\\\\x79\"" };
+#endif
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	std::vector<std::string> expected{ "my files\t*.txt", "C:\\data\\x.txt" };
+	EXPECT_EQ(us.get_values("file"), expected);
+	EXPECT_EQ(us.get_values("field_separator"), std::vector<std::string>{ "\t" });
+	EXPECT_EQ(us.get_values("date_format"), std::vector<std::string>{ "d\"m\\y" });
+}
+
+TEST_F(UsageTest, Check_UTF8)
+{
+	us.get_Argument("extension")->check_utf8 = true;
+	std::string fixed{ std::string{ us.switch_char } + "f:3,7" };
+	std::string valid{ std::string{ us.switch_char } + "o:\xC3\xA9t\xE2\x82\xAC\xF0\x9F\x98\x80.txt" };
+	std::vector<char*> argv{ "program.exe", "files*.txt", &fixed[0], &valid[0] };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	for (auto bad : { "\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xE2\x82" })
+	{
+		std::string invalid{ std::string{ us.switch_char } + "o:0123456789abcdefghijklmnopqrstuvwxyz" + bad };
+		argv.back() = &invalid[0];
+		us.set_parameters((int)argv.size(), &argv[0]);
+		EXPECT_EQ(us.error(), Usage::Parse_Error::invalid_utf8);
+	}
+	// long values are checked by blocks of 16 or 32 bytes, the sequences may cross the blocks
+	std::string piece{ "ascii \xC3\xA9t\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 " };
+	std::string text{};
+	while (text.size() < 1000)
+		text += piece;
+	std::string long_valid{ std::string{ us.switch_char } + "o:" + text };
+	argv.back() = &long_valid[0];
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	for (auto bad : { "\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xE2\x82", "\x80" })
+	{
+		for (size_t offset : { size_t{ 0 }, piece.size(), 3 * piece.size(), 24 * piece.size(), text.size() })
+		{
+			std::string invalid{ std::string{ us.switch_char } + "o:" + text.substr(0, offset) + bad + text.substr(offset) };
+			argv.back() = &invalid[0];
+			auto ret = us.set_parameters((int)argv.size(), &argv[0]);
+			EXPECT_EQ(us.error(), Usage::Parse_Error::invalid_utf8) << offset;
+			EXPECT_NE(ret.find("at byte " + std::to_string(offset)), std::string::npos) << ret;
+		}
+	}
+}
+
+TEST_F(UsageTest, Limits)
+{
+	std::string fixed{ std::string{ us.switch_char } + "f:3,7" };
+	std::vector<char*> argv{ "program.exe", "file1.txt", "file2.txt", "file3.txt", &fixed[0] };
+	us.limits.max_tokens = 3;
+	us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::limit_exceeded);
+	us.limits = {};
+	us.limits.max_bytes = 30;
+	us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::limit_exceeded);
+	us.limits = {};
+	us.limits.max_value_length = 8;
+	us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::limit_exceeded);
+	us.limits = {};
+	us.limits.max_values = 2;
+	us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_EQ(us.error(), Usage::Parse_Error::limit_exceeded);
+	us.limits.max_values = 3;
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	us.limits.max_value_length = 8;
+	std::string longer{ std::string{ us.switch_char } + "o:extension" };
+	EXPECT_STRNE(us.set_parameter(longer).c_str(), "");
+	// the arguments passed to set_parameter() are added to the bytes of the command line
+	us.limits = {};
+	us.limits.max_bytes = 40;
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	std::string extension{ std::string{ us.switch_char } + "o:txt" };
+	EXPECT_STREQ(us.set_parameter(extension).c_str(), "");
+	EXPECT_STRNE(us.set_parameter(extension).c_str(), "");
+	// the bytes following a null char are counted
+	us.limits = {};
+	us.limits.max_value_length = 12;
+	std::string hidden{ "file1.txt" };
+	hidden += '\0';
+	hidden += "0123456789";
+	Usage::Parser parser{ us };
+	EXPECT_FALSE(parser.push(hidden));
+	EXPECT_EQ(parser.state().error, Usage::Parse_Error::limit_exceeded);
+	auto states = us.parse_batch({ { hidden, fixed } }, Usage::Batch_Mode::sequential);
+	EXPECT_EQ(states[0].error, Usage::Parse_Error::limit_exceeded);
+}
+
+TEST_F(UsageTest, Parser)
+{
+	std::string fixed{ std::string{ us.switch_char } + "f:3,7" };
+	std::vector<std::string> args{ "file1.txt", "file2.txt", fixed };
+	Usage::Parser first{ us };
+	Usage::Parser second{ us };
+	for (auto& arg : args)
+	{
+		// the parsings are interleaved
+		EXPECT_TRUE(first.push(arg));
+		if (arg != fixed)
+		{
+			EXPECT_TRUE(second.push(arg));
+		}
+	}
+	EXPECT_FALSE(second.push(std::string{ us.switch_char } + "unknown"));
+	EXPECT_FALSE(second.push("file3.txt"));
+	EXPECT_STREQ(first.finish().c_str(), "");
+	EXPECT_STRNE(second.finish().c_str(), "");
+	us.restore(first.state());
+	EXPECT_EQ(us.get_values("file"), (std::vector<std::string>{ "file1.txt", "file2.txt" }));
+	EXPECT_EQ(us.get_values("fixed"), std::vector<std::string>{ "3,7" });
+	// the deprecated aliases are counted once, whatever the number of calls to finish()
+	us.add_alias("old_fixed", "fixed", true);
+	Usage::Parser third{ us };
+	EXPECT_TRUE(third.push("file1.txt"));
+	EXPECT_TRUE(third.push(std::string{ us.switch_char } + "old_fixed:3,7"));
+	EXPECT_STREQ(third.finish().c_str(), "");
+	EXPECT_STREQ(third.finish().c_str(), "");
+	EXPECT_EQ(us.get_deprecated_uses()["old_fixed"], 1);
+}
+
+TEST_F(UsageTest, Parse_Batch)
+{
+	std::string sw{ us.switch_char };
+	std::vector<std::vector<std::string>> lines{};
+	for (size_t i = 0; i < 1000; i++)
+	{
+		switch (i % 4)
+		{
+		case 0: lines.push_back({ "file" + std::to_string(i) + ".txt", sw + "f:3,7" }); break;
+		case 1: lines.push_back({ "file.txt", sw + "p:1", sw + "f:3" }); break;
+		case 2: lines.push_back({ "file.txt", sw + "unknown" }); break;
+		case 3: lines.push_back({ "file.txt", sw + "s:;" }); break;
+		}
+	}
+	std::vector<std::string> expected{};
+	for (auto& line : lines)
+	{
+		std::vector<char*> argv{ "program.exe" };
+		for (auto& arg : line)
+			argv.push_back(const_cast<char*>(arg.c_str()));
+		expected.push_back(us.set_parameters((int)argv.size(), &argv[0]));
+	}
+	for (auto mode : { Usage::Batch_Mode::sequential, Usage::Batch_Mode::parallel, Usage::Batch_Mode::pipeline })
+	{
+		auto states = us.parse_batch(lines, mode);
+		ASSERT_EQ(states.size(), lines.size());
+		for (size_t i = 0; i < lines.size(); i++)
+			EXPECT_EQ(states[i].message, expected[i]);
+	}
+	us.restore(us.parse_batch(lines, Usage::Batch_Mode::pipeline)[4]);
+	EXPECT_EQ(us.get_values("file"), std::vector<std::string>{ "file4.txt" });
+}
+
+TEST_F(UsageTest, Components)
+{
+	// a large usage made of independent pairs of arguments in conflict
+	Usage::Usage large{ "program.exe" };
+	for (size_t i = 0; i < 5000; i++)
+	{
+		Usage::Named_Arg arg{ "a" + std::to_string(i) };
+		large.add_Argument(arg);
+		if (i % 2 == 1)
+			large.add_conflict("a" + std::to_string(i - 1), "a" + std::to_string(i));
+	}
+	large.add_requirement("a4000", "a10");
+	std::string sw{ large.switch_char };
+	std::vector<std::string> args{ sw + "a3000", sw + "a4001", sw + "a100", sw + "a4000", sw + "a2001", sw + "a2000" };
+	std::vector<char*> argv{ "program.exe" };
+	for (auto& arg : args)
+		argv.push_back(&arg[0]);
+	// the first broken rule in the order of the arguments is reported
+	EXPECT_EQ(large.set_parameters((int)argv.size(), &argv[0]), "Arguments 'a2000' and 'a2001' can't be used together - see program.exe " + sw + large.help_arg + " for help.");
+	argv.pop_back();
+	argv.pop_back();
+	EXPECT_EQ(large.set_parameters((int)argv.size(), &argv[0]), "Missing required argument 'a10' - see program.exe " + sw + large.help_arg + " for help.");
+	args[2] = sw + "a10";
+	argv[3] = &args[2][0];
+	EXPECT_EQ(large.set_parameters((int)argv.size(), &argv[0]), "Arguments 'a4000' and 'a4001' can't be used together - see program.exe " + sw + large.help_arg + " for help.");
+}
+
+class Counting_Resource : public std::pmr::memory_resource
+{
+public:
+	size_t allocated{ 0 };
+	size_t deallocated{ 0 };
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		allocated += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override
+	{
+		deallocated += bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+TEST_F(UsageTest, Memory_Resource)
+{
+	Counting_Resource resource{};
+	{
+		Usage::Usage arena{ "program.exe", &resource };
+		Usage::Named_Arg o{ "extension" };
+		o.set_type(Usage::Argument_Type::string);
+		arena.add_Argument(o);
+		Usage::Unnamed_Arg file{ "file" };
+		arena.add_Argument(file);
+		EXPECT_GE(resource.allocated, sizeof(Usage::Named_Arg) + sizeof(Usage::Unnamed_Arg));
+		std::string ext{ std::string{ arena.switch_char } + "extension:txt" };
+		std::vector<char*> argv{ "program.exe", "file.txt", &ext[0] };
+		EXPECT_STREQ(arena.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+		// the keys of the patterns, of the deprecated uses and of the help index are longer than the small string buffer
+		Usage::Named_Arg code{ "identification_code" };
+		code.set_type(Usage::Argument_Type::string);
+		code.set_pattern("[A-Z]{3}-[0-9]{4}-[0-9]{4}-[0-9]{4}");
+		code.helpstring = "Identification code of the customer account";
+		arena.add_Argument(code);
+		arena.add_alias("old_identification_code", "identification_code", true);
+		auto before = resource.allocated;
+		std::string id{ std::string{ arena.switch_char } + "old_identification_code:ABC-1234-5678-9012" };
+		argv.push_back(&id[0]);
+		EXPECT_STREQ(arena.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+		EXPECT_EQ(arena.get_deprecated_uses()["old_identification_code"], 1);
+		EXPECT_FALSE(arena.search_help("identification").empty());
+		EXPECT_GE(resource.allocated - before, std::string{ "[A-Z]{3}-[0-9]{4}-[0-9]{4}-[0-9]{4}" }.size() + std::string{ "old_identification_code" }.size());
+		arena.remove_all();
+		EXPECT_TRUE(arena.get_Arguments().empty());
+		arena.add_Argument(file);
+	}
+	EXPECT_EQ(resource.allocated, resource.deallocated);
+}
+
+TEST_F(UsageTest, Print_Argument)
+{
+	// the definition printed through a base class reference is the one of the actual kind of argument
+	const Usage::Argument& named = *us.get_Argument("extension");
+	const Usage::Argument& unnamed = *us.get_Argument("file");
+	std::ostringstream os{};
+	os << named;
+	EXPECT_EQ(os.str().rfind("<named>\n", 0), 0);
+	EXPECT_NE(os.str().find("\t<shortcut_char>o</shortcut_char>\n"), std::string::npos);
+	EXPECT_NE(os.str().find("\t<default_value>sor.txt</default_value>\n"), std::string::npos);
+	os.str("");
+	os << unnamed;
+	EXPECT_EQ(os.str().rfind("<unnamed>\n", 0), 0);
+	EXPECT_NE(os.str().find("\t<many>true</many>\n"), std::string::npos);
+}
+
+TEST_F(UsageTest, Create_Syntax)
+{
+	std::string sw{ us.switch_char };
+	EXPECT_EQ(us.get_syntax(), "program.exe file... [" + sw + "o:extension] [" + sw + "n:decimal_separator] [" + sw + "d:date_format] [" + sw + "reverse,r] ["
+		+ sw + "b:begin] ([" + sw + "s:field_separator] " + sw + "p:position | " + sw + "f:fixed)");
+	EXPECT_TRUE(us.syntax_is_valid());
+	Usage::Named_Arg v{ "verbose" };
+	v.set_type(Usage::Argument_Type::boolean);
+	us.add_Argument(v);
+	us.add_requirement("verbose", "reverse");
+	EXPECT_FALSE(us.syntax_is_valid());
+	EXPECT_EQ(us.get_syntax(), "program.exe file... [" + sw + "o:extension] [" + sw + "n:decimal_separator] [" + sw + "d:date_format] [[" + sw + "verbose{+|-}] "
+		+ sw + "reverse,r] [" + sw + "b:begin] ([" + sw + "s:field_separator] " + sw + "p:position | " + sw + "f:fixed)");
+	us.set_syntax("program.exe files...");
+	EXPECT_EQ(us.get_syntax(), "program.exe files...");
+	Usage::Usage cycle{ "program.exe" };
+	Usage::Named_Arg a{ "a" };
+	Usage::Named_Arg b{ "b" };
+	cycle.add_Argument(a);
+	cycle.add_Argument(b);
+	cycle.add_requirement("a", "b");
+	cycle.add_requirement("b", "a");
+	EXPECT_EQ(cycle.get_syntax(), "program.exe [[" + sw + "b] " + sw + "a]");
+}
+
+TEST_F(UsageTest, Compile_Syntax)
+{
+	std::string sw{ us.switch_char };
+	Usage::Usage compiled{ "program.exe" };
+	auto syntax = us.get_syntax();
+	EXPECT_STREQ(compiled.compile_syntax(syntax, { { "file", "File(s) to compute." } }).c_str(), "");
+	EXPECT_EQ(compiled.get_syntax(), syntax);
+	EXPECT_EQ(compiled.get_Arguments().size(), us.get_Arguments().size());
+	EXPECT_EQ(compiled.get_Argument("file")->helpstring, "File(s) to compute.");
+	EXPECT_TRUE(compiled.get_Argument("position")->required());
+	EXPECT_FALSE(compiled.get_Argument("extension")->required());
+	EXPECT_EQ(static_cast<Usage::Named_Arg*>(compiled.get_Argument("extension"))->shortcut_char, 'o');
+	EXPECT_TRUE(compiled.requirement_exists("field_separator", "position"));
+	EXPECT_TRUE(compiled.in_conflict("position", "fixed"));
+	std::string fixed{ sw + "f:3,7" };
+	std::string reverse{ sw + "r" };
+	std::vector<char*> argv{ "program.exe", "files*.txt", &fixed[0], &reverse[0] };
+	EXPECT_STREQ(compiled.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_STRNE(compiled.compile_syntax("program.exe file [" + sw + "a:name").c_str(), "");
+	EXPECT_STRNE(compiled.compile_syntax("program.exe (" + sw + "a | [" + sw + "b])").c_str(), "");
+	EXPECT_STRNE(compiled.compile_syntax("program.exe " + sw + "a " + sw + "a").c_str(), "");
+	EXPECT_STRNE(compiled.compile_syntax("program.exe " + sw + "a,bc").c_str(), "");
+	EXPECT_STRNE(compiled.compile_syntax(syntax, { { "files", "File(s) to compute." } }).c_str(), "");
+	EXPECT_EQ(compiled.get_Arguments().size(), us.get_Arguments().size());
+	EXPECT_STREQ(compiled.compile_syntax("program.exe [" + sw + "a (" + sw + "b)]").c_str(), "");
+	EXPECT_FALSE(compiled.get_Argument("b")->required());
+	EXPECT_TRUE(compiled.requirement_exists("a", "b"));
+}
+
+TEST_F(UsageTest, Syntax_Round_Trip)
+{
+	Usage::Named_Arg v{ "verbose" };
+	v.set_type(Usage::Argument_Type::boolean);
+	v.shortcut_char = 'v';
+	v.helpstring = "Displays the progress.";
+	us.add_Argument(v);
+	std::unordered_map<std::string, std::string> helpstrings{};
+	for (auto arg : us.get_Arguments())
+		helpstrings[arg->name()] = arg->helpstring;
+	Usage::Usage compiled{ "program.exe" };
+	EXPECT_STREQ(compiled.compile_syntax(us.get_syntax(), helpstrings).c_str(), "");
+	EXPECT_EQ(compiled.get_syntax(), us.get_syntax());
+	// read through the const accessors, which keep the lookup tables and the help
+	const auto& reader = compiled;
+	auto arguments = std::as_const(us).get_Arguments();
+	ASSERT_EQ(reader.get_Arguments().size(), arguments.size());
+	EXPECT_EQ(reader.get_Argument("unknown"), nullptr);
+	for (auto arg : arguments)
+	{
+		auto copy = reader.get_Argument(arg->name());
+		ASSERT_NE(copy, nullptr) << arg->name();
+		EXPECT_EQ(copy->named(), arg->named());
+		EXPECT_EQ(copy->required(), arg->required());
+		EXPECT_EQ(copy->helpstring, arg->helpstring);
+		if (!arg->named())
+			continue;
+		EXPECT_EQ(static_cast<const Usage::Named_Arg*>(copy)->type(), static_cast<const Usage::Named_Arg*>(arg)->type());
+		EXPECT_EQ(static_cast<const Usage::Named_Arg*>(copy)->shortcut_char, static_cast<const Usage::Named_Arg*>(arg)->shortcut_char);
+	}
+}
+
+TEST_F(UsageTest, Help_Layout)
+{
+	std::string filler(28, ' ');
+	auto& help = us.help();
+	EXPECT_NE(help.find("    fixed, f                Position(s) in chars and length(s) of the field(s) to sort, separated by comma ','.\n"
+		+ filler + "Letter L is used to separate position and length of a field.\n"), std::string::npos);
+	EXPECT_NE(help.find("    field_separator, s      Field separator.\n" + filler + "'Tab' by default.\n"), std::string::npos);
+	auto& wrapped = us.help(60);
+	EXPECT_EQ(&wrapped, &us.help(60));
+	EXPECT_NE(wrapped.find("    fixed, f                Position(s) in chars and\n" + filler + "length(s) of the field(s) to\n"
+		+ filler + "sort, separated by comma ','.\n" + filler + "Letter L is used to separate\n"), std::string::npos);
+	size_t start{ 0 };
+	while (start < wrapped.size())
+	{
+		auto end = wrapped.find('\n', start);
+		EXPECT_LE(end - start, 60);
+		start = end + 1;
+	}
+	us.get_Argument("reverse")->helpstring = "Descending sort.";
+	EXPECT_NE(us.help(60).find("    reverse, r              Descending sort.\n"), std::string::npos);
+}
+
+TEST_F(UsageTest, Search_Help)
+{
+	std::string query{ us.switch_char + us.help_arg + ":Separ" };
+	std::vector<char*> argv{ "program.exe", &query[0] };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "?");
+	EXPECT_EQ(us.help_term(), "Separ");
+	auto found = us.search_help(us.help_term());
+	EXPECT_EQ(found, "    field_separator, s      Field separator.\n                            'Tab' by default.\n"
+		"    decimal_separator, n    Decimal separator.\n                            '.' by default.\n"
+		"    position, p             Number(s) of the field(s) to sort, separated by comma ','.\n"
+		"    fixed, f                Position(s) in chars and length(s) of the field(s) to sort, separated by comma ','.\n"
+		"                            Letter L is used to separate position and length of a field.\n");
+	EXPECT_EQ(us.search_help("field sort desc"), "");
+	EXPECT_EQ(us.search_help("date form"), us.search_help("DATE_FORMAT"));
+	EXPECT_NE(us.search_help("date form").find("    date_format, d"), std::string::npos);
+	us.get_Argument("reverse")->helpstring = "Descending sort.";
+	EXPECT_EQ(us.search_help("desc"), "    reverse, r    Descending sort.\n");
+	std::string reverse{ us.switch_char + std::string{ "r" } };
+	argv[1] = &reverse[0];
+	us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_EQ(us.help_term(), "");
+	// an argument that has the help argument as shortcut receives the values
+	Usage::Named_Arg height{ "height" };
+	height.set_type(Usage::Argument_Type::string);
+	height.shortcut_char = us.help_arg[0];
+	us.add_Argument(height);
+	std::string file{ "file.txt" };
+	std::string fixed{ us.switch_char + std::string{ "f:3" } };
+	query = us.switch_char + us.help_arg + ":5";
+	argv = { "program.exe", &file[0], &fixed[0], &query[0] };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(us.get_values("height")[0], "5");
+}
+
+TEST_F(UsageTest, Buffer_Command_Line)
+{
+	std::string sw{ us.switch_char };
+	std::string buffer{ "program.exe" };
+	for (auto arg : { std::string{ "files*.txt" }, sw + "f:3,7", sw + "r" })
+		buffer += '\0' + arg;
+	EXPECT_STREQ(us.set_parameters(buffer.data(), buffer.size()).c_str(), "");
+	EXPECT_EQ(us.get_values()["fixed"][0], "3,7");
+	buffer += '\0';
+	EXPECT_STREQ(us.set_parameters(buffer.data(), buffer.size()).c_str(), "");
+	buffer += sw + "z";
+	EXPECT_STRNE(us.set_parameters(buffer.data(), buffer.size()).c_str(), "");
+	EXPECT_EQ(us.error(), Usage::Parse_Error::unknown_argument);
+	us.limits.max_value_length = 5;
+	EXPECT_STRNE(us.set_parameters(buffer.data(), buffer.size()).c_str(), "");
+	EXPECT_EQ(us.error(), Usage::Parse_Error::limit_exceeded);
+	EXPECT_STRNE(us.set_parameters(buffer.data(), 0).c_str(), "");
+	EXPECT_EQ(us.error(), Usage::Parse_Error::no_argument);
+#ifdef __linux__
+	Usage::Usage all{ "" };
+	auto audits = all.audit_processes();
+	auto self = std::find_if(audits.begin(), audits.end(), [](const Usage::Process_Audit& audit) { return audit.pid == getpid(); });
+	EXPECT_NE(self, audits.end());
+	EXPECT_TRUE(std::is_sorted(audits.begin(), audits.end(), [](auto& a, auto& b) { return a.pid < b.pid; }));
+#endif
+}
+
+#ifdef __linux__
+TEST_F(UsageTest, Audit_Processes)
+{
+	auto is_self = [](const Usage::Process_Audit& audit) { return audit.pid == getpid(); };
+	// the program is found by its name, its path or its name with .exe
+	auto exe = std::filesystem::read_symlink("/proc/self/exe");
+	for (auto& name : { exe.filename().string(), exe.string(), exe.filename().string() + ".exe" })
+	{
+		Usage::Usage self{ name };
+		auto audits = self.audit_processes(Usage::Batch_Mode::sequential);
+		EXPECT_EQ(std::count_if(audits.begin(), audits.end(), is_self), 1) << name;
+	}
+	// a script is found as the first argument of its interpreter that is not an option
+	auto script = std::filesystem::temp_directory_path() / "usage-static-audit.sh";
+	std::ofstream{ script } << "sleep 10\n";
+	std::string path{ script.string() };
+	std::vector<char*> argv{ "sh", "-e", &path[0], "data.txt", nullptr };
+	pid_t child{ 0 };
+	ASSERT_EQ(posix_spawn(&child, "/bin/sh", nullptr, nullptr, &argv[0], environ), 0);
+	// waits for the child to run the interpreter
+	for (std::string cmdline; cmdline.find(path) == std::string::npos;)
+	{
+		std::ifstream proc{ "/proc/" + std::to_string(child) + "/cmdline" };
+		cmdline.assign(std::istreambuf_iterator<char>{ proc }, {});
+	}
+	Usage::Usage tool{ "usage-static-audit.sh" };
+	Usage::Unnamed_Arg file{ "file" };
+	tool.add_Argument(file);
+	auto audits = tool.audit_processes(Usage::Batch_Mode::sequential);
+	kill(child, SIGKILL);
+	waitpid(child, nullptr, 0);
+	std::filesystem::remove(script);
+	auto found = std::find_if(audits.begin(), audits.end(), [child](const Usage::Process_Audit& audit) { return audit.pid == child; });
+	ASSERT_NE(found, audits.end());
+	EXPECT_STREQ(found->state.message.c_str(), "");
+	EXPECT_EQ(found->state.values[0], std::vector<std::string>{ "data.txt" });
+}
+#endif
+
+TEST_F(UsageTest, Load_From_File)
+{
+	std::string sw{ us.switch_char };
+	auto file = std::filesystem::temp_directory_path() / "usage-static-schema.txt";
+	std::ofstream{ file } << "# schema of the sort program\n" << us.get_syntax() << "\n\nfile: File(s) to compute.\nfixed : Position(s) of the fields.\n\tLetter L separates position and length.\n";
+	Usage::Usage loaded{ "" };
+	EXPECT_STREQ(loaded.load_from_file(file.string()).c_str(), "");
+	EXPECT_EQ(loaded.program_name, "program.exe");
+	EXPECT_EQ(loaded.get_syntax(), us.get_syntax());
+	EXPECT_EQ(loaded.get_Argument("file")->helpstring, "File(s) to compute.");
+	EXPECT_EQ(loaded.get_Argument("fixed")->helpstring, "Position(s) of the fields.\nLetter L separates position and length.");
+	std::ofstream{ file } << "program.exe file\n: no name\n";
+	EXPECT_STRNE(loaded.load_from_file(file.string()).c_str(), "");
+	std::ofstream{ file } << "program.exe (" + sw + "a\n";
+	EXPECT_STRNE(loaded.load_from_file(file.string()).c_str(), "");
+	std::ofstream{ file } << "program.exe file\nfiles: File(s) to compute.\n";
+	EXPECT_STRNE(loaded.load_from_file(file.string()).c_str(), "");
+	EXPECT_EQ(loaded.get_syntax(), us.get_syntax());
+	std::filesystem::remove(file);
+	EXPECT_STRNE(loaded.load_from_file(file.string()).c_str(), "");
+}
+
+TEST_F(UsageTest, Computed_Default)
+{
+	std::string sw{ us.switch_char };
+	static_cast<Usage::Named_Arg*>(us.get_Argument("decimal_separator"))->set_default_value("field_separator", { { ";", "," } }, ".");
+	size_t calls{ 0 };
+	static_cast<Usage::Named_Arg*>(us.get_Argument("date_format"))->set_default_value([&calls](const Usage::Default_Values&) { calls++; return std::string{ "y-m-d" }; });
+	std::string position{ sw + "p:1" };
+	std::string separator{ sw + "s:;" };
+	std::vector<char*> argv{ "program.exe", "files*.txt", &position[0], &separator[0] };
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(calls, 1);
+	EXPECT_EQ(us.get_Argument("date_format")->value, std::vector<std::string>{ "y-m-d" });
+	EXPECT_EQ(us.get_values("date_format")[0], "y-m-d");
+	EXPECT_EQ(calls, 1);
+	EXPECT_EQ(us.get_values("decimal_separator")[0], ",");
+	EXPECT_STREQ(us.set_parameter(sw + "s:,").c_str(), "");
+	EXPECT_EQ(us.get_values()["decimal_separator"][0], ".");
+	EXPECT_EQ(calls, 2);
+	// date_format is the fifth argument
+	auto state = us.snapshot();
+	EXPECT_TRUE(state.defaults[4]);
+	EXPECT_EQ(state.values[4], std::vector<std::string>{ "y-m-d" });
+	// a computed default value can read another one
+	static_cast<Usage::Named_Arg*>(us.get_Argument("extension"))->set_default_value([](const Usage::Default_Values& values) { return values.get_values("date_format")[0] + ".txt"; });
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(us.get_values("extension")[0], "y-m-d.txt");
+	// the states of a batch hold the computed default values of their own command line
+	std::vector<std::vector<std::string>> lines{};
+	for (size_t i = 0; i < 100; i++)
+		lines.push_back({ "file.txt", position, sw + "s:" + (i % 2 == 0 ? ";" : ",") });
+	for (auto mode : { Usage::Batch_Mode::sequential, Usage::Batch_Mode::parallel, Usage::Batch_Mode::pipeline })
+	{
+		auto states = us.parse_batch(lines, mode);
+		for (size_t i = 0; i < states.size(); i++)
+		{
+			EXPECT_STREQ(states[i].message.c_str(), "");
+			EXPECT_EQ(states[i].values[3], std::vector<std::string>{ i % 2 == 0 ? "," : "." });
+			EXPECT_EQ(states[i].values[1], std::vector<std::string>{ "y-m-d.txt" });
+		}
+	}
+}
+
+TEST_F(UsageTest, Computed_Default_Cycle)
+{
+	std::string sw{ us.switch_char };
+	auto first = [](const std::string& name) {
+		return [name](const Usage::Default_Values& values) { auto& v = values.get_values(name); return v.empty() ? std::string{} : v[0]; };
+	};
+	static_cast<Usage::Named_Arg*>(us.get_Argument("extension"))->set_default_value(first("date_format"));
+	static_cast<Usage::Named_Arg*>(us.get_Argument("date_format"))->set_default_value(first("extension"));
+	std::string fixed{ sw + "f:3,7" };
+	std::vector<char*> argv{ "program.exe", "files*.txt", &fixed[0] };
+	EXPECT_STRNE(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(us.error(), Usage::Parse_Error::default_cycle);
+	EXPECT_TRUE(us.get_values("extension").empty());
+	EXPECT_TRUE(us.get_values("date_format").empty());
+	// the cycle depends on the command line: it is broken when one of the arguments is passed
+	EXPECT_STREQ(us.set_parameter(sw + "o:csv").c_str(), "");
+	EXPECT_EQ(us.get_values("date_format"), std::vector<std::string>{ "csv" });
+}
+
+TEST_F(UsageTest, Value_Pool)
+{
+	std::string sw{ us.switch_char };
+	std::vector<std::vector<std::string>> lines{};
+	for (size_t i = 0; i < 1000; i++)
+		lines.push_back({ "file" + std::to_string(i % 10) + ".txt", sw + "f:3,7" });
+	auto expected = us.parse_batch(lines, Usage::Batch_Mode::sequential);
+	Usage::Value_Pool pool{};
+	for (auto mode : { Usage::Batch_Mode::sequential, Usage::Batch_Mode::parallel, Usage::Batch_Mode::pipeline })
+	{
+		auto states = us.parse_batch(lines, pool, mode);
+		ASSERT_EQ(states.size(), lines.size());
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			EXPECT_EQ(states[i].state.message, expected[i].message);
+			EXPECT_EQ(pool.expand(states[i]).values, expected[i].values);
+		}
+		// same file name, same identifier
+		EXPECT_EQ(states[3].values[states[3].offsets[0]], states[13].values[states[13].offsets[0]]);
+		EXPECT_NE(states[3].values[states[3].offsets[0]], states[4].values[states[4].offsets[0]]);
+	}
+	// the ten file names, the fixed positions and the default values of extension, separators and date format
+	EXPECT_EQ(pool.size(), 15);
+	EXPECT_EQ(pool.value(pool.intern("file3.txt")), "file3.txt");
+	EXPECT_EQ(pool.size(), 15);
+	us.restore(pool.expand(us.parse_batch(lines, pool)[4]));
+	EXPECT_EQ(us.get_values("file"), std::vector<std::string>{ "file4.txt" });
+}
+
+TEST_F(UsageTest, Case_Insensitive)
+{
+	std::string sw{ us.switch_char };
+	std::string long_name(70, 'x');
+	for (auto name : { std::string{ "Maximum_Number_Of_Lines" }, long_name })
+	{
+		Usage::Named_Arg arg{ name };
+		arg.set_type(Usage::Argument_Type::string);
+		us.add_Argument(arg);
+	}
+	std::string reverse{ sw + "REVERSE" };
+	std::string position{ sw + "P:1" };
+	std::string extension{ sw + "Extension:TXT" };
+	std::string lines{ sw + "maximum_NUMBER_of_lines:10" };
+	std::string upper_long{ sw + std::string(70, 'X') + ":1" };
+	std::vector<char*> argv{ "program.exe", "FILES*.txt", &reverse[0], &position[0], &extension[0], &lines[0], &upper_long[0] };
+	EXPECT_STRNE(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(us.error(), Usage::Parse_Error::unknown_argument);
+	us.case_insensitive = true;
+	EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(us.get_values("extension")[0], "TXT");
+	EXPECT_EQ(us.get_values("Maximum_Number_Of_Lines")[0], "10");
+	EXPECT_EQ(us.get_values(long_name)[0], "1");
+	EXPECT_FALSE(us.get_values("reverse").empty());
+	EXPECT_STREQ(us.set_parameter(sw + "D:Y-M-D").c_str(), "");
+	EXPECT_EQ(us.get_values("date_format")[0], "Y-M-D");
+	std::string help{ sw + us.help_arg };
+	std::transform(help.begin(), help.end(), help.begin(), [](char c) { return (char)std::toupper((unsigned char)c); });
+	std::vector<char*> help_argv{ "program.exe", &help[0] };
+	EXPECT_STREQ(us.set_parameters((int)help_argv.size(), &help_argv[0]).c_str(), "?");
+	us.case_insensitive = false;
+	EXPECT_STRNE(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+}
+
+TEST_F(UsageTest, Case_Insensitive_Same_Shortcut)
+{
+	// two arguments with the same shortcut: the first one wins whatever the mode
+	Usage::Named_Arg recursive{ "recursive" };
+	recursive.shortcut_char = 'r';
+	us.add_Argument(recursive);
+	std::string lower{ us.switch_char };
+	lower += 'r';
+	std::string upper{ us.switch_char };
+	upper += 'R';
+	std::string position{ us.switch_char };
+	position += "p:1";
+	std::vector<char*> argv{ "program.exe", "files*.txt", &position[0], &lower[0] };
+	for (bool folded : { false, true })
+	{
+		us.case_insensitive = folded;
+		EXPECT_STREQ(us.set_parameters((int)argv.size(), &argv[0]).c_str(), "");
+		EXPECT_FALSE(us.get_values("reverse").empty());
+		EXPECT_TRUE(us.get_values("recursive").empty());
+		EXPECT_EQ(us.set_parameter(upper) == "", folded);
+	}
+}
@@ -0,0 +1,57 @@
+# Runs the validator tool on a schema and on files of command lines, and checks its results and its exit codes
+# VALIDATE: the tool ; SWITCH: the switch char of the platform ; NULL_LINES: command lines with null separated arguments ; WORK_DIR: directory of the generated files
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+set(SCHEMA "${WORK_DIR}/schema.txt")
+file(WRITE "${SCHEMA}" "program.exe file [${SWITCH}e:extension] [${SWITCH}reverse]\nfile: Input file.\n")
+set(VALID "${WORK_DIR}/valid.txt")
+file(WRITE "${VALID}" "program.exe a.txt ${SWITCH}e:txt\n\nprogram.exe \"my file.txt\" ${SWITCH}reverse\n")
+set(INVALID "${WORK_DIR}/invalid.txt")
+file(WRITE "${INVALID}" "program.exe a.txt\nprogram.exe a.txt ${SWITCH}unknown\n")
+set(BAD_SCHEMA "${WORK_DIR}/bad-schema.txt")
+file(WRITE "${BAD_SCHEMA}" "program.exe (${SWITCH}a\n")
+
+# runs the tool and fails if its exit code is not the expected one ; its output is returned in OUT
+function(validate EXPECTED_CODE)
+	execute_process(COMMAND "${VALIDATE}" ${ARGN} RESULT_VARIABLE code OUTPUT_VARIABLE out ERROR_VARIABLE err)
+	if (NOT code EQUAL EXPECTED_CODE)
+		message(FATAL_ERROR "Exit code ${code} instead of ${EXPECTED_CODE} for '${ARGN}':\n${out}${err}")
+	endif()
+	set(OUT "${out}" PARENT_SCOPE)
+endfunction()
+
+# fails if the output has not the given line
+function(expect_line LINE)
+	string(FIND "${OUT}" "${LINE}\n" found)
+	if (found EQUAL -1)
+		message(FATAL_ERROR "Line not found: ${LINE}\nOutput:\n${OUT}")
+	endif()
+endfunction()
+
+validate(0 "${SCHEMA}" "${VALID}")
+expect_line("{\"input\":\"${VALID}\",\"line\":1,\"valid\":true,\"error\":0,\"message\":\"\",\"canonical\":\"program.exe a.txt ${SWITCH}extension:txt\"}")
+expect_line("{\"input\":\"${VALID}\",\"line\":3,\"valid\":true,\"error\":0,\"message\":\"\",\"canonical\":\"program.exe \\\"my file.txt\\\" ${SWITCH}reverse\"}")
+string(REGEX MATCHALL "\n" lines "${OUT}")
+list(LENGTH lines count)
+if (NOT count EQUAL 2)
+	message(FATAL_ERROR "2 results expected, ${count} found:\n${OUT}")
+endif()
+
+validate(1 "${SCHEMA}" "${VALID}" "${INVALID}")
+expect_line("{\"input\":\"${INVALID}\",\"line\":1,\"valid\":true,\"error\":0,\"message\":\"\",\"canonical\":\"program.exe a.txt\"}")
+string(FIND "${OUT}" "{\"input\":\"${INVALID}\",\"line\":2,\"valid\":false,\"error\":4,\"message\":\"Unknown argument '${SWITCH}unknown'" found)
+if (found EQUAL -1)
+	message(FATAL_ERROR "Unknown argument not reported:\n${OUT}")
+endif()
+
+# each null separated field is one argument, spaces included
+validate(1 "${SWITCH}0" "${SCHEMA}" "${NULL_LINES}")
+expect_line("{\"input\":\"${NULL_LINES}\",\"line\":1,\"valid\":true,\"error\":0,\"message\":\"\",\"canonical\":\"program.exe \\\"my file.txt\\\"\"}")
+string(FIND "${OUT}" "{\"input\":\"${NULL_LINES}\",\"line\":2,\"valid\":false,\"error\":3," found)
+if (found EQUAL -1)
+	message(FATAL_ERROR "Extra argument not reported:\n${OUT}")
+endif()
+
+validate(2 "${WORK_DIR}/missing.txt" "${VALID}")
+validate(2 "${BAD_SCHEMA}" "${VALID}")
+validate(2 "${SCHEMA}" "${VALID}" "${SWITCH}unknown")
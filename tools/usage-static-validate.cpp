@@ -0,0 +1,379 @@
+/*! \file usage-static-validate.cpp
+    \brief Checks stored command lines in bulk against a usage loaded from a file, and writes the result of each one as a line of JSON.
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <usage-static.hpp>
+
+namespace
+{
+    // number of command lines checked by each batch, it bounds the memory used whatever the size of the input
+    constexpr size_t BATCH_SIZE{ 65536 };
+
+    // read-only view of a whole file, mapped in memory
+    class Mapped_File
+    {
+    public:
+        explicit Mapped_File(const std::string& fname)
+        {
+#ifdef _WIN32
+            m_file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+                return;
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+                return;
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping == nullptr)
+                return;
+            m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            if (m_data != nullptr)
+                m_size = static_cast<size_t>(size.QuadPart);
+#else
+            m_fd = open(fname.c_str(), O_RDONLY);
+            if (m_fd < 0)
+                return;
+            struct stat st {};
+            if (fstat(m_fd, &st) != 0 || st.st_size == 0)
+                return;
+            auto data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (data == MAP_FAILED)
+                return;
+            madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(data);
+            m_size = static_cast<size_t>(st.st_size);
+#endif
+        }
+        Mapped_File(const Mapped_File&) = delete;
+        Mapped_File& operator=(const Mapped_File&) = delete;
+        ~Mapped_File()
+        {
+#ifdef _WIN32
+            if (m_data != nullptr)
+                UnmapViewOfFile(m_data);
+            if (m_mapping != nullptr)
+                CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE)
+                CloseHandle(m_file);
+#else
+            if (m_data != nullptr)
+                munmap(const_cast<char*>(m_data), m_size);
+            if (m_fd >= 0)
+                close(m_fd);
+#endif
+        }
+
+        // false if the file can't be opened ; an empty file is valid
+#ifdef _WIN32
+        bool opened() const noexcept { return m_file != INVALID_HANDLE_VALUE; }
+#else
+        bool opened() const noexcept { return m_fd >= 0; }
+#endif
+        std::string_view data() const noexcept { return { m_data, m_size }; }
+
+    private:
+#ifdef _WIN32
+        HANDLE m_file{ INVALID_HANDLE_VALUE };
+        HANDLE m_mapping{ nullptr };
+#else
+        int m_fd{ -1 };
+#endif
+        const char* m_data{ nullptr };
+        size_t m_size{ 0 };
+    };
+
+    // splits a command line at the spaces found out of double quotes ; the quotes are kept, they are decoded by the usage
+    std::vector<std::string> split(std::string_view line)
+    {
+        std::vector<std::string> args{};
+        std::string arg{};
+        bool quoted{ false };
+        bool in_arg{ false };
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            auto c = line[i];
+            if (!quoted && (c == ' ' || c == '\t'))
+            {
+                if (in_arg)
+                    args.push_back(std::move(arg));
+                arg.clear();
+                in_arg = false;
+                continue;
+            }
+            in_arg = true;
+            arg += c;
+            if (c == '\"')
+                quoted = !quoted;
+            else if (c == '\\' && quoted && i + 1 < line.size())
+                arg += line[++i];
+        }
+        if (in_arg)
+            args.push_back(std::move(arg));
+        return args;
+    }
+
+    // splits a command line at the null chars, each field is one argument, spaces included ; the null char ending the last field is optional
+    std::vector<std::string> split_fields(std::string_view line)
+    {
+        std::vector<std::string> args{};
+        size_t start{ 0 };
+        while (start < line.size())
+        {
+            auto end = line.find('\0', start);
+            if (end == std::string_view::npos)
+                end = line.size();
+            args.emplace_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+        return args;
+    }
+
+    // appends the text as a JSON string
+    void append_json(std::string& out, std::string_view text)
+    {
+        static const char HEX[]{ "0123456789abcdef" };
+        out += '\"';
+        for (unsigned char c : text)
+        {
+            if (c == '\"' || c == '\\')
+                out.append(1, '\\').append(1, static_cast<char>(c));
+            else if (c == '\n')
+                out += "\\n";
+            else if (c == '\t')
+                out += "\\t";
+            else if (c < 0x20)
+                out.append("\\u00").append(1, HEX[c >> 4]).append(1, HEX[c & 0xF]);
+            else
+                out += static_cast<char>(c);
+        }
+        out += '\"';
+    }
+
+    // appends the value quoted if it contains spaces, quotes or chars that must be escaped
+    void append_value(std::string& out, const std::string& value)
+    {
+        if (!value.empty() && value.find_first_of(" \t\n\"\\") == std::string::npos)
+        {
+            out += value;
+            return;
+        }
+        out += '\"';
+        for (auto c : value)
+        {
+            if (c == '\"' || c == '\\')
+                out += '\\';
+            if (c == '\n')
+                out += "\\n";
+            else if (c == '\t')
+                out += "\\t";
+            else
+                out += c;
+        }
+        out += '\"';
+    }
+
+    // the command line rebuilt from the parse state: unnamed values first, then the named arguments by their full name, in the order of the usage
+    std::string canonical(const Usage::Usage& us, const std::vector<const Usage::Argument*>& arguments, const Usage::Parse_State& state)
+    {
+        std::string result{ us.program_name };
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (size_t i = 0; i < arguments.size(); i++)
+            {
+                if (arguments[i]->named() != (pass == 1) || !state.set_args[i] || state.defaults[i])
+                    continue;
+                if (!arguments[i]->named())
+                {
+                    for (auto& value : state.values[i])
+                    {
+                        result += ' ';
+                        append_value(result, value);
+                    }
+                    continue;
+                }
+                result.append(1, ' ').append(1, us.switch_char).append(arguments[i]->name());
+                switch (static_cast<const Usage::Named_Arg*>(arguments[i])->type())
+                {
+                case Usage::Argument_Type::boolean:
+                    result += state.values[i][0] == "true" ? '+' : '-';
+                    break;
+                case Usage::Argument_Type::string:
+                    result += ':';
+                    append_value(result, state.values[i][0]);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
+    // checks the command lines of the input, a batch at a time, and writes their results
+    class Validator
+    {
+    public:
+        Validator(Usage::Usage& us, bool null_fields)
+            : m_usage{ us }, m_arguments{ std::as_const(us).get_Arguments() }, m_null_fields{ null_fields }
+        {
+            m_command_lines.reserve(BATCH_SIZE);
+            m_lines.reserve(BATCH_SIZE);
+        }
+
+        // checks the command lines of an input, named in the results ; the lines are numbered from 1 in each input
+        // the command lines end with new lines, their arguments are separated by spaces or, if m_null_fields, by null chars
+        void add(const std::string& name, std::string_view input)
+        {
+            m_input = name;
+            m_line = 0;
+            size_t start{ 0 };
+            while (start < input.size())
+            {
+                auto end = input.find('\n', start);
+                if (end == std::string_view::npos)
+                    end = input.size();
+                auto line = input.substr(start, end - start);
+                start = end + 1;
+                m_line++;
+                if (!m_null_fields && !line.empty() && line.back() == '\r')
+                    line.remove_suffix(1);
+                auto args = m_null_fields ? split_fields(line) : split(line);
+                if (args.empty())
+                    continue;
+                args.erase(args.begin());       // program name
+                m_command_lines.push_back(std::move(args));
+                m_lines.push_back(m_line);
+                if (m_command_lines.size() == BATCH_SIZE)
+                    flush();
+            }
+            flush();
+        }
+
+        // number of invalid command lines found since the start
+        size_t invalid() const noexcept { return m_invalid; }
+
+    private:
+        // checks the pending command lines and writes their results
+        void flush()
+        {
+            auto states = m_usage.parse_batch(m_command_lines, Usage::Batch_Mode::parallel);
+            std::string out{};
+            for (size_t i = 0; i < states.size(); i++)
+            {
+                bool valid{ states[i].error == Usage::Parse_Error::none };
+                out.append("{\"input\":");
+                append_json(out, m_input);
+                out.append(",\"line\":").append(std::to_string(m_lines[i]));
+                out.append(",\"valid\":").append(valid ? "true" : "false");
+                out.append(",\"error\":").append(std::to_string(static_cast<int>(states[i].error)));
+                out.append(",\"message\":");
+                append_json(out, states[i].message);
+                out.append(",\"canonical\":");
+                if (valid)
+                    append_json(out, canonical(m_usage, m_arguments, states[i]));
+                else
+                    out += "null";
+                out += "}\n";
+                if (!valid)
+                    m_invalid++;
+            }
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            m_command_lines.clear();
+            m_lines.clear();
+        }
+
+        Usage::Usage& m_usage;
+        std::vector<const Usage::Argument*> m_arguments;
+        bool m_null_fields;
+        std::vector<std::vector<std::string>> m_command_lines{};
+        std::vector<size_t> m_lines{};      // line number of each pending command line in its input
+        std::string m_input{};
+        size_t m_line{ 0 };
+        size_t m_invalid{ 0 };
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    Usage::Usage us{ "usage-static-validate" };
+    us.description = "Checks command lines against the usage described by a schema file, and writes the result of each one as a line of JSON.";
+    Usage::Unnamed_Arg schema{ "schema" };
+    schema.set_required(true);
+    schema.path_check = Usage::Path_Check::is_file;
+    schema.helpstring = "File describing the usage, as read by Usage::load_from_file().";
+    us.add_Argument(schema);
+    Usage::Unnamed_Arg file{ "file" };
+    file.many = true;
+    file.path_check = Usage::Path_Check::is_file;
+    file.helpstring = "File(s) of command lines to check, the standard input if none.";
+    us.add_Argument(file);
+    Usage::Named_Arg null{ "null" };
+    null.set_type(Usage::Argument_Type::simple);
+    null.shortcut_char = '0';
+    null.helpstring = "The arguments of each command line are separated by null chars instead of spaces, so that they can contain spaces. The command lines still end with new lines.";
+    us.add_Argument(null);
+    us.usage = "Each result gives the number of the line in its input, the error code and message, and the canonical form of the valid command lines.\n"
+        "The exit code is 1 if a command line is invalid, 2 if the arguments or the schema are invalid.";
+
+    auto ret = us.set_parameters(argc, argv);
+    if (ret == "?")
+    {
+        std::cout << us;
+        return 0;
+    }
+    if (ret != "")
+    {
+        std::cerr << ret << std::endl;
+        return 2;
+    }
+    auto values = us.get_values();
+
+    Usage::Usage target{ "" };
+    ret = target.load_from_file(values["schema"][0]);
+    if (ret != "")
+    {
+        std::cerr << ret << std::endl;
+        return 2;
+    }
+
+    Validator validator{ target, !values["null"].empty() };
+    auto& files = values["file"];
+    if (files.empty())
+    {
+        std::string input{};
+        std::vector<char> buf(1 << 16);
+        size_t n{ 0 };
+        while ((n = std::fread(buf.data(), 1, buf.size(), stdin)) > 0)
+            input.append(buf.data(), n);
+        validator.add("-", input);
+    }
+    for (auto& fname : files)
+    {
+        Mapped_File mapped{ fname };
+        if (!mapped.opened())
+        {
+            std::cerr << "Unable to read the file '" << fname << "'." << std::endl;
+            return 2;
+        }
+        validator.add(fname, mapped.data());
+    }
+    return validator.invalid() == 0 ? 0 : 1;
+}